@@ -1,4 +1,4 @@
-#include <string>
+#include "rhubarb/src/core/appInfo.h"
 
-const char* appName = "rhubarb-wasm";
-const char* appVersion = "1.0.0"; 
\ No newline at end of file
+const std::string appName = APP_NAME;
+const std::string appVersion = APP_VERSION;
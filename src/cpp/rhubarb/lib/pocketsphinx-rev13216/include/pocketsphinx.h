@@ -98,6 +98,27 @@ ps_default_search_args(cmd_ln_t *);
 POCKETSPHINX_EXPORT
 ps_decoder_t *ps_init(cmd_ln_t *config);
 
+/**
+ * Initialize a decoder that shares the acoustic model of another one.
+ *
+ * The acoustic model parameters are reference-counted and used
+ * read-only, so they are loaded once no matter how many decoders use
+ * them.  A compiled dictionary (see ps_save_dict()) is shared the same
+ * way if both decoders use the same file, together with the triphone
+ * tables built from it.  Only feature computation,
+ * added words and per-utterance search and scoring state are private
+ * to the new decoder.  The decoders may be used
+ * concurrently from different threads, but must be created and freed
+ * one at a time.
+ *
+ * @param config Configuration, as for ps_init().  It must specify the
+ *               same acoustic model as the one of <code>other</code>.
+ * @param other Decoder to share the acoustic model with.  It may be
+ *              freed before the new decoder.
+ */
+POCKETSPHINX_EXPORT
+ps_decoder_t *ps_init_shared(cmd_ln_t *config, ps_decoder_t *other);
+
 /**
  * Reinitialize the decoder with updated configuration.
  *
@@ -236,7 +257,9 @@ int ps_load_dict(ps_decoder_t *ps, char const *dictfile,
  *
  * @param dictfile Path to file where dictionary will be written.
  * @param format Format of the dictionary file, or NULL for the
- *               default (text) format (currently unused, should be NULL)
+ *               default (text) format.  "bin" writes the main dictionary
+ *               in compiled form, which is mapped into memory instead of
+ *               parsed when used as -dict.
  */
 POCKETSPHINX_EXPORT
 int ps_save_dict(ps_decoder_t *ps, char const *dictfile, char const *format);
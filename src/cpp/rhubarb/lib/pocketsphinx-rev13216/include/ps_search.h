@@ -186,6 +186,23 @@ ngram_model_t *ps_get_lm(ps_decoder_t *ps, const char *name);
 POCKETSPHINX_EXPORT
 int ps_set_lm(ps_decoder_t *ps, const char *name, ngram_model_t *lm);
 
+/**
+ * Adds new search based on N-gram language model, reusing the word
+ * mapping of the search with the same name in another decoder.
+ *
+ * Looking up every dictionary word in the language model takes most of
+ * the time of ps_set_lm().  If the other search uses a model mapped from
+ * the same binary file (see ngram_model_trie_read_bin_shared()) and both
+ * decoders share a compiled dictionary (see ps_init_shared()), the
+ * mapping of the shared words is copied instead.  Only words added to
+ * either decoder are looked up.
+ *
+ * @param other Decoder with a search of the same name, or NULL.
+ */
+POCKETSPHINX_EXPORT
+int ps_set_lm_shared(ps_decoder_t *ps, const char *name, ngram_model_t *lm,
+                     ps_decoder_t *other);
+
 /**
  * Adds new search based on N-gram language model.
  *
@@ -228,6 +228,33 @@ acmod_feat_mismatch(acmod_t *acmod, feat_t *fcb)
     return FALSE;
 }
 
+static void
+acmod_init_buffers(acmod_t *acmod)
+{
+    /* The MFCC buffer needs to be at least as large as the dynamic
+     * feature window.  */
+    acmod->n_mfc_alloc = acmod->fcb->window_size * 2 + 1;
+    acmod->mfc_buf = (mfcc_t **)
+        ckd_calloc_2d(acmod->n_mfc_alloc, acmod->fcb->cepsize,
+                      sizeof(**acmod->mfc_buf));
+
+    /* Feature buffer has to be at least as large as MFCC buffer. */
+    acmod->n_feat_alloc = acmod->n_mfc_alloc + cmd_ln_int32_r(acmod->config, "-pl_window");
+    acmod->feat_buf = feat_array_alloc(acmod->fcb, acmod->n_feat_alloc);
+    acmod->framepos = ckd_calloc(acmod->n_feat_alloc, sizeof(*acmod->framepos));
+
+    acmod->utt_start_frame = 0;
+
+    /* Senone computation stuff. */
+    acmod->senone_scores = ckd_calloc(bin_mdef_n_sen(acmod->mdef),
+                                                     sizeof(*acmod->senone_scores));
+    acmod->senone_active_vec = bitvec_alloc(bin_mdef_n_sen(acmod->mdef));
+    acmod->senone_active = ckd_calloc(bin_mdef_n_sen(acmod->mdef),
+                                                     sizeof(*acmod->senone_active));
+    acmod->log_zero = logmath_get_zero(acmod->lmath);
+    acmod->compallsen = cmd_ln_boolean_r(acmod->config, "-compallsen");
+}
+
 acmod_t *
 acmod_init(cmd_ln_t *config, logmath_t *lmath, fe_t *fe, feat_t *fcb)
 {
@@ -270,28 +297,51 @@ acmod_init(cmd_ln_t *config, logmath_t *lmath, fe_t *fe, feat_t *fcb)
         goto error_out;
 
 
-    /* The MFCC buffer needs to be at least as large as the dynamic
-     * feature window.  */
-    acmod->n_mfc_alloc = acmod->fcb->window_size * 2 + 1;
-    acmod->mfc_buf = (mfcc_t **)
-        ckd_calloc_2d(acmod->n_mfc_alloc, acmod->fcb->cepsize,
-                      sizeof(**acmod->mfc_buf));
+    acmod_init_buffers(acmod);
+    return acmod;
 
-    /* Feature buffer has to be at least as large as MFCC buffer. */
-    acmod->n_feat_alloc = acmod->n_mfc_alloc + cmd_ln_int32_r(config, "-pl_window");
-    acmod->feat_buf = feat_array_alloc(acmod->fcb, acmod->n_feat_alloc);
-    acmod->framepos = ckd_calloc(acmod->n_feat_alloc, sizeof(*acmod->framepos));
+error_out:
+    acmod_free(acmod);
+    return NULL;
+}
 
-    acmod->utt_start_frame = 0;
+acmod_t *
+acmod_copy(acmod_t *other, cmd_ln_t *config, logmath_t *lmath)
+{
+    acmod_t *acmod;
+    ps_mgau_t *mgau;
 
-    /* Senone computation stuff. */
-    acmod->senone_scores = ckd_calloc(bin_mdef_n_sen(acmod->mdef),
-                                                     sizeof(*acmod->senone_scores));
-    acmod->senone_active_vec = bitvec_alloc(bin_mdef_n_sen(acmod->mdef));
-    acmod->senone_active = ckd_calloc(bin_mdef_n_sen(acmod->mdef),
-                                                     sizeof(*acmod->senone_active));
-    acmod->log_zero = logmath_get_zero(acmod->lmath);
-    acmod->compallsen = cmd_ln_boolean_r(config, "-compallsen");
+    /* Scores computed by the shared parameters are only compatible
+     * with a log base that is the same as theirs. */
+    if (logmath_get_base(lmath) != logmath_get_base(other->lmath))
+        return NULL;
+
+    /* Only PTM models can be shared so far. */
+    if ((mgau = ptm_mgau_copy(other->mgau, config)) == NULL)
+        return NULL;
+
+    acmod = ckd_calloc(1, sizeof(*acmod));
+    acmod->config = cmd_ln_retain(config);
+    acmod->lmath = lmath;
+    acmod->state = ACMOD_IDLE;
+    acmod->mgau = mgau;
+
+    /* Feature computation keeps state between frames, so it is private. */
+    acmod->fe = fe_init_auto_r(config);
+    if (acmod->fe == NULL)
+        goto error_out;
+    if (acmod_fe_mismatch(acmod, acmod->fe))
+        goto error_out;
+    if (acmod_init_feat(acmod) < 0)
+        goto error_out;
+    if (acmod_feat_mismatch(acmod, other->fcb))
+        goto error_out;
+
+    /* Shared, read-only acoustic model parameters. */
+    acmod->mdef = bin_mdef_retain(other->mdef);
+    acmod->tmat = tmat_retain(other->tmat);
+
+    acmod_init_buffers(acmod);
     return acmod;
 
 error_out:
@@ -436,6 +486,7 @@ acmod_start_utt(acmod_t *acmod)
     acmod->senscr_frame = -1;
     acmod->n_senone_active = 0;
     acmod->mgau->frame_idx = 0;
+    acmod->mgau->n_stored_frame = 0;
     acmod->rawdata_pos = 0;
 
     return 0;
@@ -113,6 +113,8 @@ typedef struct ps_mgaufuncs_s {
 struct ps_mgau_s {
     ps_mgaufuncs_t *vt;  /**< vtable of mgau functions. */
     int frame_idx;       /**< frame counter. */
+    int n_stored_frame;  /**< Number of frames of the current utterance whose
+                              densities are kept for further passes. */
 };
 
 #define ps_mgau_base(mg) ((ps_mgau_t *)(mg))
@@ -219,6 +221,26 @@ typedef struct acmod_s acmod_t;
  */
 acmod_t *acmod_init(cmd_ln_t *config, logmath_t *lmath, fe_t *fe, feat_t *fcb);
 
+/**
+ * Initialize an acoustic model that shares the parameters of another one.
+ *
+ * The model definition, transition matrices and Gaussian mixtures are
+ * reference-counted and used read-only, so several decoders can score
+ * with one copy of them.  Feature computation and scoring buffers are
+ * private to the new object.
+ *
+ * @param other Acoustic model to share parameters with.  It may be
+ *              freed before the new object.
+ * @param config Configuration for the new object.  It must specify the
+ *               same acoustic model and feature parameters.
+ * @param lmath Log-math parameters to use for the new object.  They must
+ *              have the same base as those of <code>other</code>.  This
+ *              pointer is not retained.
+ * @return a newly initialized acmod_t, or NULL if the parameters of
+ *         <code>other</code> can't be shared.
+ */
+acmod_t *acmod_copy(acmod_t *other, cmd_ln_t *config, logmath_t *lmath);
+
 /**
  * Adapt acoustic model using a linear transform.
  *
@@ -37,10 +37,12 @@
 
 /* System headers. */
 #include <string.h>
+#include <stdlib.h>
 
 /* SphinxBase headers. */
 #include <sphinxbase/pio.h>
 #include <sphinxbase/strfuncs.h>
+#include <sphinxbase/mmio.h>
 
 /* Local headers. */
 #include "dict.h"
@@ -49,6 +51,480 @@
 #define DELIM	" \t\n"         /* Set of field separator characters */
 #define DEFAULT_NUM_PHONE	(MAX_S3CIPID+1)
 
+#define DICT_BIN_MAGIC		"PSDICTB1"
+#define DICT_BIN_BYTE_ORDER	0x11223344
+#define DICT_BIN_KEYS_PER_BUCKET	4
+#define DICT_BIN_MAX_SEED	(1 << 24)
+#define DICT_BIN_ALIGN(n)	(((n) + 3) & ~3u)
+
+/*
+ * Compiled dictionary file layout.  Sections are 4-byte aligned and
+ * stored in native byte order, so that they can be used in place.
+ */
+typedef struct {
+    char magic[8];
+    uint32 byte_order;
+    uint32 n_word;
+    uint32 n_ciphone;
+    uint32 n_bucket;
+    uint32 n_slot;
+    uint32 n_pron;
+    uint32 string_size;
+    uint32 ciphone_offset;      /* NUL-terminated CI phone names, in ID order */
+    uint32 entry_offset;        /* dict_bin_entry_t[n_word] */
+    uint32 seed_offset;         /* uint32[n_bucket] perfect hash displacements */
+    uint32 slot_offset;         /* s3wid_t[n_slot] word IDs, BAD_S3WID if empty */
+    uint32 pron_offset;         /* s3cipid_t[n_pron] packed pronunciations */
+    uint32 string_offset;       /* NUL-terminated word strings */
+    uint32 file_size;
+} dict_bin_header_t;
+
+typedef struct {
+    uint32 word;                /* Offset of the word string */
+    uint32 pron;                /* Index of the first phone */
+    int32 pronlen;
+    s3wid_t alt;
+    s3wid_t basewid;
+} dict_bin_entry_t;
+
+struct dict_bin_s {
+    int refcnt;
+    char *filename;
+    mmio_file_t *mf;
+    dict_bin_header_t const *header;
+    char const *ciphones;
+    dict_bin_entry_t const *entries;
+    uint32 const *seeds;
+    s3wid_t const *slots;
+    s3cipid_t const *prons;
+    char const *strings;
+};
+
+/*
+ * The perfect hash is built with "hash and displace": keys are grouped
+ * into buckets by one hash, and each bucket gets a displacement seed
+ * that sends all its keys to free slots.  A lookup costs two string
+ * hashes, one seed and one slot read, and a single string comparison.
+ */
+static uint32
+dict_bin_mix(uint32 h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+static void
+dict_bin_hash(char const *word, uint32 *h1, uint32 *h2)
+{
+    uint32 a = 2166136261u, b = 0x9747b28cu;
+
+    for (; *word; ++word) {
+        a = (a ^ (uint8) *word) * 16777619u;
+        b = (b ^ (uint8) *word) * 0x5bd1e995u;
+        b ^= b >> 15;
+    }
+    *h1 = dict_bin_mix(a);
+    *h2 = dict_bin_mix(b);
+}
+
+static uint32
+dict_bin_slot(uint32 h1, uint32 h2, uint32 seed, uint32 n_slot)
+{
+    return (h1 ^ dict_bin_mix(h2 ^ (seed * 0x9e3779b9u))) % n_slot;
+}
+
+static s3wid_t
+dict_bin_wordid(dict_bin_t *bin, char const *word)
+{
+    uint32 h1, h2, seed;
+    s3wid_t w;
+
+    dict_bin_hash(word, &h1, &h2);
+    seed = bin->seeds[h1 % bin->header->n_bucket];
+    w = bin->slots[dict_bin_slot(h1, h2, seed, bin->header->n_slot)];
+    if (NOT_S3WID(w) || 0 != strcmp(bin->strings + bin->entries[w].word, word))
+        return BAD_S3WID;
+    return w;
+}
+
+/* Returns TRUE if the file starts like a compiled dictionary. */
+static int
+dict_bin_probe(char const *filename)
+{
+    FILE *fp;
+    char magic[sizeof(DICT_BIN_MAGIC) - 1];
+    int compiled;
+
+    if ((fp = fopen(filename, "rb")) == NULL)
+        return FALSE;
+    compiled = fread(magic, 1, sizeof(magic), fp) == sizeof(magic)
+        && 0 == memcmp(magic, DICT_BIN_MAGIC, sizeof(magic));
+    fclose(fp);
+    return compiled;
+}
+
+static void
+dict_bin_free(dict_bin_t *bin)
+{
+    if (bin == NULL || --bin->refcnt > 0)
+        return;
+    mmio_file_unmap(bin->mf);
+    ckd_free(bin->filename);
+    ckd_free(bin);
+}
+
+/* Checks that all sections and the indices stored in them are in range. */
+static int
+dict_bin_validate(dict_bin_t *bin)
+{
+    dict_bin_header_t const *h = bin->header;
+    char const *name, *end;
+    uint32 i;
+
+    if (h->n_bucket == 0 || h->n_slot == 0 || h->string_size == 0
+        || h->ciphone_offset < sizeof(*h)
+        || h->entry_offset < h->ciphone_offset
+        || h->seed_offset < h->entry_offset + h->n_word * sizeof(dict_bin_entry_t)
+        || h->slot_offset < h->seed_offset + h->n_bucket * sizeof(uint32)
+        || h->pron_offset < h->slot_offset + h->n_slot * sizeof(s3wid_t)
+        || h->string_offset < h->pron_offset + h->n_pron * sizeof(s3cipid_t)
+        || h->file_size < h->string_offset + h->string_size
+        || bin->strings[h->string_size - 1] != '\0')
+        return -1;
+
+    name = bin->ciphones;
+    end = (char const *) h + h->entry_offset;
+    for (i = 0; i < h->n_ciphone; ++i) {
+        name = memchr(name, '\0', end - name);
+        if (name == NULL)
+            return -1;
+        ++name;
+    }
+    for (i = 0; i < h->n_word; ++i) {
+        dict_bin_entry_t const *e = bin->entries + i;
+        if (e->word >= h->string_size || e->pronlen <= 0
+            || e->pron > h->n_pron || (uint32) e->pronlen > h->n_pron - e->pron
+            || e->basewid < 0 || (uint32) e->basewid >= h->n_word
+            || e->alt >= (s3wid_t) h->n_word)
+            return -1;
+    }
+    for (i = 0; i < h->n_slot; ++i) {
+        if (bin->slots[i] >= (s3wid_t) h->n_word)
+            return -1;
+    }
+    return 0;
+}
+
+static dict_bin_t *
+dict_bin_read(char const *filename)
+{
+    FILE *fp;
+    dict_bin_header_t header;
+    dict_bin_t *bin;
+    char const *data;
+    long size;
+
+    /* Check the header before mapping, as the mapping size is implicit */
+    if ((fp = fopen(filename, "rb")) == NULL) {
+        E_ERROR_SYSTEM("Failed to open dictionary file '%s' for reading", filename);
+        return NULL;
+    }
+    if (fread(&header, sizeof(header), 1, fp) != 1
+        || fseek(fp, 0L, SEEK_END) < 0
+        || (size = ftell(fp)) < 0) {
+        E_ERROR("Failed to read compiled dictionary '%s'\n", filename);
+        fclose(fp);
+        return NULL;
+    }
+    fclose(fp);
+    if (header.byte_order != DICT_BIN_BYTE_ORDER) {
+        E_ERROR("Compiled dictionary '%s' has the wrong byte order\n", filename);
+        return NULL;
+    }
+    if ((uint32) size != header.file_size) {
+        E_ERROR("Compiled dictionary '%s' is truncated\n", filename);
+        return NULL;
+    }
+
+    bin = (dict_bin_t *) ckd_calloc(1, sizeof(*bin));
+    bin->refcnt = 1;
+    if ((bin->mf = mmio_file_read(filename)) == NULL) {
+        ckd_free(bin);
+        return NULL;
+    }
+    bin->filename = ckd_salloc(filename);
+    data = (char const *) mmio_file_ptr(bin->mf);
+    bin->header = (dict_bin_header_t const *) data;
+    bin->ciphones = data + header.ciphone_offset;
+    bin->entries = (dict_bin_entry_t const *) (data + header.entry_offset);
+    bin->seeds = (uint32 const *) (data + header.seed_offset);
+    bin->slots = (s3wid_t const *) (data + header.slot_offset);
+    bin->prons = (s3cipid_t const *) (data + header.pron_offset);
+    bin->strings = data + header.string_offset;
+    if (dict_bin_validate(bin) < 0) {
+        E_ERROR("Compiled dictionary '%s' is corrupt\n", filename);
+        dict_bin_free(bin);
+        return NULL;
+    }
+    return bin;
+}
+
+/* Phone IDs are stored directly, so they must mean the same in mdef. */
+static int
+dict_bin_check_phones(dict_bin_t *bin, bin_mdef_t *mdef)
+{
+    char const *name = bin->ciphones;
+    uint32 i;
+
+    for (i = 0; i < bin->header->n_ciphone; ++i) {
+        if (mdef == NULL || bin_mdef_ciphone_id(mdef, name) != (int) i) {
+            E_ERROR("Compiled dictionary '%s' was built for a different acoustic model\n",
+                    bin->filename);
+            return -1;
+        }
+        name += strlen(name) + 1;
+    }
+    return 0;
+}
+
+/* Points the first dictionary entries into the compiled dictionary. */
+static void
+dict_bin_attach(dict_t *d, dict_bin_t *bin)
+{
+    uint32 i;
+
+    for (i = 0; i < bin->header->n_word; ++i) {
+        dict_bin_entry_t const *e = bin->entries + i;
+        dictword_t *wordp = d->word + i;
+        wordp->word = (char *) bin->strings + e->word;
+        wordp->ciphone = (s3cipid_t *) bin->prons + e->pron;
+        wordp->pronlen = e->pronlen;
+        wordp->alt = e->alt;
+        wordp->basewid = e->basewid;
+    }
+    d->bin = bin;
+    d->n_bin_word = d->n_word = bin->header->n_word;
+}
+
+typedef struct {
+    uint32 size;
+    uint32 bucket;
+} dict_bin_bucket_t;
+
+static int
+dict_bin_bucket_cmp(const void *a, const void *b)
+{
+    dict_bin_bucket_t const *x = a, *y = b;
+    if (x->size != y->size)
+        return x->size > y->size ? -1 : 1;
+    return x->bucket < y->bucket ? -1 : x->bucket > y->bucket;
+}
+
+/* Assigns every main dictionary word its own slot. */
+static int
+dict_bin_build_hash(dict_t *d, uint32 n_word, uint32 n_bucket, uint32 n_slot,
+                    uint32 *seeds, s3wid_t *slots)
+{
+    uint32 *h1, *h2, *keys, *start, *pos;
+    dict_bin_bucket_t *order;
+    uint32 i, j, k, max_size;
+    int rv = 0;
+
+    h1 = ckd_calloc(n_word, sizeof(*h1));
+    h2 = ckd_calloc(n_word, sizeof(*h2));
+    keys = ckd_calloc(n_word, sizeof(*keys));
+    start = ckd_calloc(n_bucket + 1, sizeof(*start));
+    order = ckd_calloc(n_bucket, sizeof(*order));
+
+    /* Group the keys by bucket */
+    for (i = 0; i < n_word; ++i) {
+        dict_bin_hash(d->word[i].word, &h1[i], &h2[i]);
+        ++start[h1[i] % n_bucket + 1];
+    }
+    max_size = 0;
+    for (i = 0; i < n_bucket; ++i) {
+        order[i].size = start[i + 1];
+        order[i].bucket = i;
+        if (start[i + 1] > max_size)
+            max_size = start[i + 1];
+        start[i + 1] += start[i];
+    }
+    for (i = 0; i < n_word; ++i)
+        keys[start[h1[i] % n_bucket]++] = i;
+    for (i = n_bucket; i > 0; --i)
+        start[i] = start[i - 1];
+    start[0] = 0;
+
+    /* Place the largest buckets first, while most slots are free */
+    qsort(order, n_bucket, sizeof(*order), dict_bin_bucket_cmp);
+    pos = ckd_calloc(max_size + 1, sizeof(*pos));
+    for (i = 0; i < n_slot; ++i)
+        slots[i] = BAD_S3WID;
+    for (i = 0; i < n_bucket && order[i].size > 0; ++i) {
+        uint32 b = order[i].bucket, seed;
+        uint32 const *bkeys = keys + start[b];
+
+        for (seed = 0; seed < DICT_BIN_MAX_SEED; ++seed) {
+            for (j = 0; j < order[i].size; ++j) {
+                pos[j] = dict_bin_slot(h1[bkeys[j]], h2[bkeys[j]], seed, n_slot);
+                if (IS_S3WID(slots[pos[j]]))
+                    break;
+                for (k = 0; k < j && pos[k] != pos[j]; ++k);
+                if (k < j)
+                    break;
+            }
+            if (j == order[i].size)
+                break;
+        }
+        if (seed == DICT_BIN_MAX_SEED) {
+            E_ERROR("Failed to build perfect hash for dictionary\n");
+            rv = -1;
+            break;
+        }
+        seeds[b] = seed;
+        for (j = 0; j < order[i].size; ++j)
+            slots[pos[j]] = bkeys[j];
+    }
+
+    ckd_free(pos);
+    ckd_free(order);
+    ckd_free(start);
+    ckd_free(keys);
+    ckd_free(h2);
+    ckd_free(h1);
+    return rv;
+}
+
+static int
+dict_bin_write_section(FILE *fh, void const *data, size_t size)
+{
+    static const char padding[4] = { 0 };
+    size_t pad = DICT_BIN_ALIGN(size) - size;
+
+    if (size > 0 && fwrite(data, 1, size, fh) != size)
+        return -1;
+    if (pad > 0 && fwrite(padding, 1, pad, fh) != pad)
+        return -1;
+    return 0;
+}
+
+static int
+dict_write_bin(dict_t *d, char const *filename)
+{
+    dict_bin_header_t header;
+    dict_bin_entry_t *entries;
+    uint32 *seeds;
+    s3wid_t *slots;
+    s3cipid_t *prons;
+    char *ciphones, *strings;
+    uint32 i, ciphone_size;
+    FILE *fh;
+    int rv = -1;
+
+    if (d->mdef == NULL) {
+        E_ERROR("Cannot compile a dictionary without acoustic model\n");
+        return -1;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DICT_BIN_MAGIC, sizeof(header.magic));
+    header.byte_order = DICT_BIN_BYTE_ORDER;
+    header.n_word = d->filler_start;
+    header.n_ciphone = bin_mdef_n_ciphone(d->mdef);
+    header.n_bucket = header.n_word / DICT_BIN_KEYS_PER_BUCKET + 1;
+    header.n_slot = header.n_word + header.n_word / 4 + 1;
+
+    ciphone_size = 0;
+    for (i = 0; i < header.n_ciphone; ++i)
+        ciphone_size += strlen(bin_mdef_ciphone_str(d->mdef, i)) + 1;
+    header.string_size = 1;
+    for (i = 0; i < header.n_word; ++i) {
+        header.n_pron += d->word[i].pronlen;
+        header.string_size += strlen(d->word[i].word) + 1;
+    }
+
+    header.ciphone_offset = DICT_BIN_ALIGN(sizeof(header));
+    header.entry_offset = header.ciphone_offset + DICT_BIN_ALIGN(ciphone_size);
+    header.seed_offset = header.entry_offset + header.n_word * sizeof(*entries);
+    header.slot_offset = header.seed_offset + header.n_bucket * sizeof(*seeds);
+    header.pron_offset = header.slot_offset + header.n_slot * sizeof(*slots);
+    header.string_offset = header.pron_offset
+        + DICT_BIN_ALIGN(header.n_pron * sizeof(*prons));
+    header.file_size = header.string_offset + DICT_BIN_ALIGN(header.string_size);
+
+    ciphones = ckd_calloc(ciphone_size + 1, 1);
+    entries = ckd_calloc(header.n_word + 1, sizeof(*entries));
+    seeds = ckd_calloc(header.n_bucket, sizeof(*seeds));
+    slots = ckd_calloc(header.n_slot, sizeof(*slots));
+    prons = ckd_calloc(header.n_pron + 1, sizeof(*prons));
+    strings = ckd_calloc(header.string_size, 1);
+
+    ciphone_size = 0;
+    for (i = 0; i < header.n_ciphone; ++i) {
+        char const *name = bin_mdef_ciphone_str(d->mdef, i);
+        strcpy(ciphones + ciphone_size, name);
+        ciphone_size += strlen(name) + 1;
+    }
+
+    /* Offset 0 is the empty string, so no word has offset 0 */
+    header.string_size = 1;
+    header.n_pron = 0;
+    for (i = 0; i < header.n_word; ++i) {
+        dictword_t const *wordp = d->word + i;
+        s3wid_t alt = wordp->alt;
+
+        /* Skip alternatives added after the main dictionary */
+        while (alt >= (s3wid_t) header.n_word)
+            alt = d->word[alt].alt;
+        entries[i].word = header.string_size;
+        entries[i].pron = header.n_pron;
+        entries[i].pronlen = wordp->pronlen;
+        entries[i].alt = alt;
+        entries[i].basewid = wordp->basewid;
+        strcpy(strings + header.string_size, wordp->word);
+        header.string_size += strlen(wordp->word) + 1;
+        memcpy(prons + header.n_pron, wordp->ciphone,
+               wordp->pronlen * sizeof(*prons));
+        header.n_pron += wordp->pronlen;
+    }
+
+    if (dict_bin_build_hash(d, header.n_word, header.n_bucket, header.n_slot,
+                            seeds, slots) < 0)
+        goto error_out;
+
+    if ((fh = fopen(filename, "wb")) == NULL) {
+        E_ERROR_SYSTEM("Failed to open '%s'", filename);
+        goto error_out;
+    }
+    if (dict_bin_write_section(fh, &header, sizeof(header)) < 0
+        || dict_bin_write_section(fh, ciphones, ciphone_size) < 0
+        || dict_bin_write_section(fh, entries, header.n_word * sizeof(*entries)) < 0
+        || dict_bin_write_section(fh, seeds, header.n_bucket * sizeof(*seeds)) < 0
+        || dict_bin_write_section(fh, slots, header.n_slot * sizeof(*slots)) < 0
+        || dict_bin_write_section(fh, prons, header.n_pron * sizeof(*prons)) < 0
+        || dict_bin_write_section(fh, strings, header.string_size) < 0) {
+        E_ERROR_SYSTEM("Failed to write '%s'", filename);
+        fclose(fh);
+        goto error_out;
+    }
+    fclose(fh);
+    E_INFO("Compiled %d words into %d KiB\n", header.n_word, header.file_size / 1024);
+    rv = 0;
+
+error_out:
+    ckd_free(strings);
+    ckd_free(prons);
+    ckd_free(slots);
+    ckd_free(seeds);
+    ckd_free(entries);
+    ckd_free(ciphones);
+    return rv;
+}
+
 #if WIN32
 #define snprintf sprintf_s
 #endif 
@@ -84,6 +560,10 @@ dict_add_word(dict_t * d, char const *word, s3cipid_t const * p, int32 np)
     s3wid_t newwid;
     char *wword;
 
+    /* Words of a compiled dictionary are not in the hash table */
+    if (d->bin && IS_S3WID(dict_bin_wordid(d->bin, word)))
+        return BAD_S3WID;
+
     if (d->n_word >= d->max_words) {
         E_INFO("Reallocating to %d KiB for word entries\n",
                (d->max_words + S3DICT_INC_SZ) * sizeof(dictword_t) / 1024);
@@ -103,7 +583,7 @@ dict_add_word(dict_t * d, char const *word, s3cipid_t const * p, int32 np)
         int32 w;
 
         /* Truncated to a baseword string; find its ID */
-        if (hash_table_lookup_int32(d->ht, wword, &w) < 0) {
+        if (NOT_S3WID(w = dict_wordid(d, wword))) {
             E_ERROR("Missing base word for: %s\n", word);
             ckd_free(wword);
             ckd_free(wordp->word);
@@ -144,6 +624,24 @@ dict_add_word(dict_t * d, char const *word, s3cipid_t const * p, int32 np)
     return newwid;
 }
 
+void
+dict_truncate(dict_t * d, int32 n_word)
+{
+    /* Newest first, so each alternative pronunciation heads its list */
+    while (d->n_word > n_word) {
+        dictword_t *wordp = d->word + d->n_word - 1;
+
+        if (wordp->basewid != d->n_word - 1)
+            d->word[wordp->basewid].alt = wordp->alt;
+        hash_table_delete(d->ht, wordp->word);
+        ckd_free(wordp->word);
+        ckd_free(wordp->ciphone);
+        wordp->word = NULL;
+        wordp->ciphone = NULL;
+        --d->n_word;
+    }
+}
+
 
 static int32
 dict_read(FILE * fp, dict_t * d)
@@ -223,6 +721,9 @@ dict_write(dict_t *dict, char const *filename, char const *format)
     FILE *fh;
     int i;
 
+    if (format && 0 == strcmp(format, "bin"))
+        return dict_write_bin(dict, filename);
+
     if ((fh = fopen(filename, "w")) == NULL) {
         E_ERROR_SYSTEM("Failed to open '%s'", filename);
         return -1;
@@ -250,11 +751,19 @@ dict_write(dict_t *dict, char const *filename, char const *format)
 
 dict_t *
 dict_init(cmd_ln_t *config, bin_mdef_t * mdef)
+{
+    return dict_init_shared(config, mdef, NULL);
+}
+
+
+dict_t *
+dict_init_shared(cmd_ln_t *config, bin_mdef_t * mdef, dict_t *other)
 {
     FILE *fp, *fp2;
     int32 n;
     lineiter_t *li;
     dict_t *d;
+    dict_bin_t *bin;
     s3cipid_t sil;
     char const *dictfile = NULL, *fillerfile = NULL;
 
@@ -269,8 +778,25 @@ dict_init(cmd_ln_t *config, bin_mdef_t * mdef)
      * all the required memory in one go.
      */
     fp = NULL;
+    bin = NULL;
     n = 0;
-    if (dictfile) {
+    if (dictfile && other && other->bin
+        && 0 == strcmp(other->bin->filename, dictfile)) {
+        bin = other->bin;
+        ++bin->refcnt;
+    }
+    else if (dictfile && dict_bin_probe(dictfile)) {
+        if ((bin = dict_bin_read(dictfile)) == NULL)
+            return NULL;
+    }
+    if (bin) {
+        if (dict_bin_check_phones(bin, mdef) < 0) {
+            dict_bin_free(bin);
+            return NULL;
+        }
+        n = bin->header->n_word;
+    }
+    else if (dictfile) {
         if ((fp = fopen(dictfile, "r")) == NULL) {
             E_ERROR_SYSTEM("Failed to open dictionary file '%s' for reading", dictfile);
             return NULL;
@@ -287,7 +813,9 @@ dict_init(cmd_ln_t *config, bin_mdef_t * mdef)
     if (fillerfile) {
         if ((fp2 = fopen(fillerfile, "r")) == NULL) {
             E_ERROR_SYSTEM("Failed to open filler dictionary file '%s' for reading", fillerfile);
-            fclose(fp);
+            if (fp)
+                fclose(fp);
+            dict_bin_free(bin);
             return NULL;
 	}
         for (li = lineiter_start(fp2); li; li = lineiter_next(li)) {
@@ -311,6 +839,7 @@ dict_init(cmd_ln_t *config, bin_mdef_t * mdef)
                 MAX_S3WID);
         fclose(fp);
         fclose(fp2);
+        dict_bin_free(bin);
         ckd_free(d);
         return NULL;
     }
@@ -326,7 +855,7 @@ dict_init(cmd_ln_t *config, bin_mdef_t * mdef)
     /* Create new hash table for word strings; case-insensitive word strings */
     if (config && cmd_ln_exists_r(config, "-dictcase"))
         d->nocase = cmd_ln_boolean_r(config, "-dictcase");
-    d->ht = hash_table_new(d->max_words, d->nocase);
+    d->ht = hash_table_new(bin ? d->max_words - n : d->max_words, d->nocase);
 
     /* Digest main dictionary file */
     if (fp) {
@@ -335,6 +864,19 @@ dict_init(cmd_ln_t *config, bin_mdef_t * mdef)
         fclose(fp);
         E_INFO("%d words read\n", d->n_word);
     }
+    else if (bin) {
+        if (d->nocase) {
+            E_ERROR("Compiled dictionary '%s' cannot be used with -dictcase\n", dictfile);
+            if (fp2)
+                fclose(fp2);
+            dict_bin_free(bin);
+            dict_free(d);
+            return NULL;
+        }
+        E_INFO("Mapping compiled main dictionary: %s\n", dictfile);
+        dict_bin_attach(d, bin);
+        E_INFO("%d words mapped\n", d->n_word);
+    }
 
     if (dict_wordid(d, S3_START_WORD) != BAD_S3WID) {
 	E_ERROR("Remove sentence start word '<s>' from the dictionary\n");
@@ -403,6 +945,8 @@ dict_wordid(dict_t *d, const char *word)
     assert(d);
     assert(word);
 
+    if (d->bin && IS_S3WID(w = dict_bin_wordid(d->bin, word)))
+        return w;
     if (hash_table_lookup_int32(d->ht, word, &w) < 0)
         return (BAD_S3WID);
     return w;
@@ -476,7 +1020,7 @@ dict_free(dict_t * d)
         return d->refcnt;
 
     /* First Step, free all memory allocated for each word */
-    for (i = 0; i < d->n_word; i++) {
+    for (i = d->n_bin_word; i < d->n_word; i++) {
         word = (dictword_t *) & (d->word[i]);
         if (word->word)
             ckd_free((void *) word->word);
@@ -488,6 +1032,7 @@ dict_free(dict_t * d)
         ckd_free((void *) d->word);
     if (d->ht)
         hash_table_free(d->ht);
+    dict_bin_free(d->bin);
     if (d->mdef)
         bin_mdef_free(d->mdef);
     ckd_free((void *) d);
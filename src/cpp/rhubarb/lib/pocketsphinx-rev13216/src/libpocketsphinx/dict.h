@@ -68,6 +68,12 @@ typedef struct {
     s3wid_t basewid;	/**< Base pronunciation id */
 } dictword_t;
 
+/**
+ * Compiled main dictionary, mapped read-only from a file written by
+ * dict_write() in "bin" format.  Shared between dictionaries.
+ */
+typedef struct dict_bin_s dict_bin_t;
+
 /** 
     \struct dict_t
     \brief a structure for a dictionary. 
@@ -86,6 +92,8 @@ typedef struct {
     s3wid_t finishwid;	/**< FOR INTERNAL-USE ONLY */
     s3wid_t silwid;	/**< FOR INTERNAL-USE ONLY */
     int nocase;
+    dict_bin_t *bin;	/**< Compiled main dictionary, or NULL if read from text */
+    int32 n_bin_word;	/**< #Entries whose strings and phones point into bin */
 } dict_t;
 
 
@@ -104,8 +112,26 @@ dict_t *dict_init(cmd_ln_t *config, /**< Configuration (-dict, -fdict, -dictcase
                   bin_mdef_t *mdef  /**< For looking up CI phone IDs (or NULL) */
     );
 
+/**
+ * Initialize a new dictionary, sharing the compiled main dictionary of
+ * another one if both use the same -dict file.
+ *
+ * If the -dict file was written by dict_write() in "bin" format, it is
+ * mapped into memory instead of being parsed, and word lookups use its
+ * perfect hash.  Words added later (including fillers) are kept in the
+ * hash table as usual.
+ */
+dict_t *dict_init_shared(cmd_ln_t *config, /**< Configuration (-dict, -fdict, -dictcase) or NULL */
+                         bin_mdef_t *mdef, /**< For looking up CI phone IDs (or NULL) */
+                         dict_t *other     /**< Dictionary to share the compiled main dictionary with (or NULL) */
+    );
+
 /**
  * Write dictionary to a file.
+ *
+ * If format is "bin", the main dictionary (all words before the
+ * fillers) is written in compiled form, which can be loaded by
+ * dict_init() without parsing.  Otherwise it is written as text.
  */
 int dict_write(dict_t *dict, char const *filename, char const *format);
 
@@ -139,6 +165,15 @@ s3wid_t dict_add_word(dict_t *d,          /**< The dictionary structure. */
                       int32 np            /**< Number of phones. */
     );
 
+/**
+ * Remove the words added by dict_add_word() after the dictionary had the
+ * given size, so it can be reused without growing.  Searches built after
+ * these words were added must be freed first.
+ */
+void dict_truncate(dict_t *d,    /**< The dictionary structure. */
+                   int32 n_word  /**< Number of words to keep. */
+    );
+
 /**
  * Return value: CI phone string for the given word, phone position.
  */
@@ -263,6 +263,65 @@ free_compress_map(xwdssid_t ** tree, int32 n_ci)
     ckd_free(tree);
 }
 
+static int
+tables_are_shared(dict2pid_t *d2p)
+{
+    return d2p->shared && d2p->ldiph_lc == d2p->shared->ldiph_lc;
+}
+
+static s3ssid_t ***
+copy_3d(s3ssid_t ***table, int32 n_ci)
+{
+    s3ssid_t ***copy = (s3ssid_t ***) ckd_calloc_3d(n_ci, n_ci, n_ci,
+                                                    sizeof(s3ssid_t));
+    memcpy(copy[0][0], table[0][0],
+           (size_t) n_ci * n_ci * n_ci * sizeof(s3ssid_t));
+    return copy;
+}
+
+static xwdssid_t **
+copy_compress_map(xwdssid_t ** tree, int32 n_ci)
+{
+    xwdssid_t **copy;
+    int32 b, l;
+
+    copy = (xwdssid_t **) ckd_calloc(n_ci, sizeof(*copy));
+    for (b = 0; b < n_ci; b++) {
+        copy[b] = (xwdssid_t *) ckd_calloc(n_ci, sizeof(**copy));
+        for (l = 0; l < n_ci; l++) {
+            xwdssid_t *src = &tree[b][l];
+            if (src->n_ssid == 0)
+                continue;
+            copy[b][l].ssid = ckd_calloc(src->n_ssid, sizeof(s3ssid_t));
+            memcpy(copy[b][l].ssid, src->ssid,
+                   src->n_ssid * sizeof(s3ssid_t));
+            copy[b][l].cimap = ckd_calloc(n_ci, sizeof(s3cipid_t));
+            memcpy(copy[b][l].cimap, src->cimap, n_ci * sizeof(s3cipid_t));
+            copy[b][l].n_ssid = src->n_ssid;
+        }
+    }
+    return copy;
+}
+
+/*
+ * Makes private copies of shared tables before they are modified.  The
+ * reference to the shared structure is only dropped in dict2pid_free(),
+ * so this doesn't touch its reference count.
+ */
+static void
+unshare_tables(dict2pid_t *d2p)
+{
+    int32 n_ci = bin_mdef_n_ciphone(d2p->mdef);
+
+    if (!tables_are_shared(d2p))
+        return;
+    E_INFO("Copying shared PID tables\n");
+    d2p->ldiph_lc = copy_3d(d2p->ldiph_lc, n_ci);
+    d2p->lrdiph_rc = copy_3d(d2p->lrdiph_rc, n_ci);
+    d2p->rssid = copy_compress_map(d2p->rssid, n_ci);
+    d2p->lrssid = copy_compress_map(d2p->lrssid, n_ci);
+}
+
 static void
 populate_lrdiph(dict2pid_t *d2p, s3ssid_t ***rdiph_rc, s3cipid_t b)
 {
@@ -307,6 +366,7 @@ dict2pid_add_word(dict2pid_t *d2p,
          * word. */
         if (d2p->ldiph_lc[dict_first_phone(d, wid)][dict_second_phone(d, wid)][0]
             == BAD_S3SSID) {
+            unshare_tables(d2p);
             E_DEBUG(2, ("Filling in left-context diphones for %s(?,%s)\n",
                    bin_mdef_ciphone_str(mdef, dict_first_phone(d, wid)),
                    bin_mdef_ciphone_str(mdef, dict_second_phone(d, wid))));
@@ -327,6 +387,7 @@ dict2pid_add_word(dict2pid_t *d2p,
             s3cipid_t *tmpcimap;
             s3cipid_t r;
 
+            unshare_tables(d2p);
             E_DEBUG(2, ("Filling in right-context diphones for %s(%s,?)\n",
                    bin_mdef_ciphone_str(mdef, dict_last_phone(d, wid)),
                    bin_mdef_ciphone_str(mdef, dict_second_last_phone(d, wid))));
@@ -356,6 +417,7 @@ dict2pid_add_word(dict2pid_t *d2p,
         E_INFO("Filling in context triphones for %s(?,?)\n",
                bin_mdef_ciphone_str(mdef, dict_first_phone(d, wid)));
         if (d2p->lrdiph_rc[dict_first_phone(d, wid)][0][0] == BAD_S3SSID) {
+            unshare_tables(d2p);
             populate_lrdiph(d2p, NULL, dict_first_phone(d, wid));
         }
     }
@@ -496,6 +558,34 @@ dict2pid_build(bin_mdef_t * mdef, dict_t * dict)
     return dict2pid;
 }
 
+dict2pid_t *
+dict2pid_build_shared(bin_mdef_t * mdef, dict_t * dict, dict2pid_t * other)
+{
+    dict2pid_t *dict2pid;
+    int32 w;
+
+    if (other == NULL || other->mdef != mdef || dict->bin == NULL
+        || other->dict->bin != dict->bin)
+        return dict2pid_build(mdef, dict);
+
+    E_INFO("Sharing PID tables of compiled dictionary\n");
+    dict2pid = (dict2pid_t *) ckd_calloc(1, sizeof(dict2pid_t));
+    dict2pid->refcount = 1;
+    dict2pid->mdef = bin_mdef_retain(mdef);
+    dict2pid->dict = dict_retain(dict);
+    dict2pid->shared = dict2pid_retain(other);
+    dict2pid->ldiph_lc = other->ldiph_lc;
+    dict2pid->rssid = other->rssid;
+    dict2pid->lrdiph_rc = other->lrdiph_rc;
+    dict2pid->lrssid = other->lrssid;
+
+    /* The compiled words are covered, the fillers most likely as well */
+    for (w = dict->n_bin_word; w < dict_size(dict); w++)
+        dict2pid_add_word(dict2pid, w);
+
+    return dict2pid;
+}
+
 dict2pid_t *
 dict2pid_retain(dict2pid_t *d2p)
 {
@@ -511,6 +601,14 @@ dict2pid_free(dict2pid_t * d2p)
     if (--d2p->refcount > 0)
         return d2p->refcount;
 
+    if (tables_are_shared(d2p)) {
+        d2p->ldiph_lc = NULL;
+        d2p->lrdiph_rc = NULL;
+        d2p->rssid = NULL;
+        d2p->lrssid = NULL;
+    }
+    dict2pid_free(d2p->shared);
+
     if (d2p->ldiph_lc)
         ckd_free_3d((void ***) d2p->ldiph_lc);
 
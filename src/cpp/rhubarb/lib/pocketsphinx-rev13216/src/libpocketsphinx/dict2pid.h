@@ -81,7 +81,7 @@ typedef struct {
    \brief Building composite triphone (as well as word internal triphones) with the dictionary. 
 */
 
-typedef struct {
+typedef struct dict2pid_s {
     int refcount;
 
     bin_mdef_t *mdef;           /**< Model definition, used to generate
@@ -109,6 +109,10 @@ typedef struct {
                                     First dimension: base phone,
                                     Second dimension: left context. 
                                  */
+
+    struct dict2pid_s *shared;  /**< Structure whose tables this one was
+                                   created with, or NULL.  The tables are
+                                   copied before they are modified. */
 } dict2pid_t;
 
 /** Access macros; not designed for arbitrary use */
@@ -123,6 +127,21 @@ dict2pid_t *dict2pid_build(bin_mdef_t *mdef,   /**< A  model definition*/
                            dict_t *dict        /**< An initialized dictionary */
     );
 
+/**
+ * Build the dict2pid structure for the given model/dictionary, sharing
+ * the tables of another one if it was built for the same model and
+ * compiled dictionary.
+ *
+ * The tables only depend on which phone combinations occur in the
+ * dictionary, so they fit any dictionary whose words are a subset of the
+ * other's.  Words added later only cause a private copy of the tables if
+ * they need combinations that aren't in them yet.
+ */
+dict2pid_t *dict2pid_build_shared(bin_mdef_t *mdef,
+                                  dict_t *dict,
+                                  dict2pid_t *other /**< May be NULL */
+    );
+
 /**
  * Retain a pointer to dict2pid
  */
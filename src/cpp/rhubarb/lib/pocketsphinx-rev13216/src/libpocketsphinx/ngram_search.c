@@ -54,6 +54,7 @@
 #include "ngram_search.h"
 #include "ngram_search_fwdtree.h"
 #include "ngram_search_fwdflat.h"
+#include "ngram_model_set.h"
 
 static int ngram_search_start(ps_search_t *search);
 static int ngram_search_step(ps_search_t *search, int frame_idx);
@@ -78,7 +79,7 @@ static ps_searchfuncs_t ngram_funcs = {
 static ngram_model_t *default_lm;
 
 static void
-ngram_search_update_widmap(ngram_search_t *ngs)
+ngram_search_update_widmap(ngram_search_t *ngs, ngram_search_t *other)
 {
     char const **words;
     int32 i, n_words;
@@ -89,7 +90,8 @@ ngram_search_update_widmap(ngram_search_t *ngs)
     /* This will include alternates, again, that's okay since they aren't in the LM */
     for (i = 0; i < n_words; ++i)
         words[i] = dict_wordstr(ps_search_dict(ngs), i);
-    ngram_model_set_map_words(ngs->lmset, words, n_words);
+    ngram_model_set_map_words_shared(ngs->lmset, words, n_words,
+                                     other ? other->lmset : NULL);
     ckd_free(words);
 }
 
@@ -143,6 +145,18 @@ ngram_search_init(const char *name,
                   acmod_t *acmod,
                   dict_t *dict,
                   dict2pid_t *d2p)
+{
+    return ngram_search_init_shared(name, lm, config, acmod, dict, d2p, NULL);
+}
+
+ps_search_t *
+ngram_search_init_shared(const char *name,
+                         ngram_model_t *lm,
+                         cmd_ln_t *config,
+                         acmod_t *acmod,
+                         dict_t *dict,
+                         dict2pid_t *d2p,
+                         ps_search_t *other)
 {
     ngram_search_t *ngs;
     static char *lmname = "default";
@@ -195,7 +209,13 @@ ngram_search_init(const char *name,
     ngs->active_word_list = ckd_calloc_2d(2, dict_size(dict),
                                           sizeof(**ngs->active_word_list));
 
-    ngs->lmset = ngram_model_set_init(config, &lm, &lmname, NULL, 1);
+    /* A set can be searched directly.  Wrapping it in another set would
+     * merge and map its whole vocabulary a second time.  The set's words
+     * are mapped to the dictionary below, like those of a wrapper. */
+    if (ngram_model_is_set(lm))
+        ngs->lmset = ngram_model_retain(lm);
+    else
+        ngs->lmset = ngram_model_set_init(config, &lm, &lmname, NULL, 1);
     if (!ngs->lmset)
         goto error_out;
 
@@ -208,7 +228,7 @@ ngram_search_init(const char *name,
     }
 
     /* Create word mappings. */
-    ngram_search_update_widmap(ngs);
+    ngram_search_update_widmap(ngs, (ngram_search_t *)other);
 
     /* Initialize fwdtree, fwdflat, bestpath modules if necessary. */
     if (cmd_ln_boolean_r(config, "-fwdtree")) {
@@ -270,7 +290,7 @@ ngram_search_reinit(ps_search_t *search, dict_t *dict, dict2pid_t *d2p)
     ngram_search_calc_beams(ngs);
 
     /* Update word mappings. */
-    ngram_search_update_widmap(ngs);
+    ngram_search_update_widmap(ngs, NULL);
 
     /* Now rebuild lextrees. */
     if (ngs->fwdtree) {
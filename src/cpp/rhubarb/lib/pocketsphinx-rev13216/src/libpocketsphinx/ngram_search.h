@@ -367,6 +367,18 @@ ps_search_t *ngram_search_init(const char *name,
                                dict_t *dict,
                                dict2pid_t *d2p);
 
+/**
+ * Initialize the N-Gram search module, copying the word mapping of
+ * another N-Gram search where it applies (see ps_set_lm_shared()).
+ */
+ps_search_t *ngram_search_init_shared(const char *name,
+                                      ngram_model_t *lm,
+                                      cmd_ln_t *config,
+                                      acmod_t *acmod,
+                                      dict_t *dict,
+                                      dict2pid_t *d2p,
+                                      ps_search_t *other);
+
 /**
  * Finalize the N-Gram search module.
  */
@@ -213,8 +213,19 @@ ps_default_search_args(cmd_ln_t *config)
 #endif
 }
 
+static int
+ps_reinit_shared(ps_decoder_t *ps, cmd_ln_t *config, ps_decoder_t *other);
+
 int
 ps_reinit(ps_decoder_t *ps, cmd_ln_t *config)
+{
+    return ps_reinit_shared(ps, config, NULL);
+}
+
+/* Reinitialize a decoder, sharing the acoustic model parameters and
+ * the compiled dictionary of another decoder if it is not NULL. */
+static int
+ps_reinit_shared(ps_decoder_t *ps, cmd_ln_t *config, ps_decoder_t *other)
 {
     const char *path;
     const char *keyphrase;
@@ -271,8 +282,14 @@ ps_reinit(ps_decoder_t *ps, cmd_ln_t *config)
 
     /* Acoustic model (this is basically everything that
      * uttproc.c, senscr.c, and others used to do) */
-    if ((ps->acmod = acmod_init(ps->config, ps->lmath, NULL, NULL)) == NULL)
-        return -1;
+    if (other)
+        ps->acmod = acmod_copy(other->acmod, ps->config, ps->lmath);
+    if (ps->acmod == NULL) {
+        if (other)
+            E_INFO("Acoustic model can't be shared, loading a new copy\n");
+        if ((ps->acmod = acmod_init(ps->config, ps->lmath, NULL, NULL)) == NULL)
+            return -1;
+    }
 
 
 
@@ -287,11 +304,14 @@ ps_reinit(ps_decoder_t *ps, cmd_ln_t *config)
                          ps->phone_loop);
     }
 
-    /* Dictionary and triphone mappings (depends on acmod). */
+    /* Dictionary and triphone mappings (depends on acmod).  With a shared
+     * compiled dictionary, the triphone mappings are shared as well. */
     /* FIXME: pass config, change arguments, implement LTS, etc. */
-    if ((ps->dict = dict_init(ps->config, ps->acmod->mdef)) == NULL)
+    if ((ps->dict = dict_init_shared(ps->config, ps->acmod->mdef,
+                                     other ? other->dict : NULL)) == NULL)
         return -1;
-    if ((ps->d2p = dict2pid_build(ps->acmod->mdef, ps->dict)) == NULL)
+    if ((ps->d2p = dict2pid_build_shared(ps->acmod->mdef, ps->dict,
+                                         other ? other->d2p : NULL)) == NULL)
         return -1;
 
     lw = cmd_ln_float32_r(ps->config, "-lw");
@@ -383,6 +403,25 @@ ps_reinit(ps_decoder_t *ps, cmd_ln_t *config)
     return 0;
 }
 
+ps_decoder_t *
+ps_init_shared(cmd_ln_t *config, ps_decoder_t *other)
+{
+    ps_decoder_t *ps;
+    
+    if (!config) {
+	E_ERROR("No configuration specified");
+	return NULL;
+    }
+
+    ps = ckd_calloc(1, sizeof(*ps));
+    ps->refcount = 1;
+    if (ps_reinit_shared(ps, config, other) < 0) {
+        ps_free(ps);
+        return NULL;
+    }
+    return ps;
+}
+
 ps_decoder_t *
 ps_init(cmd_ln_t *config)
 {
@@ -584,8 +623,21 @@ set_search_internal(ps_decoder_t *ps, ps_search_t *search)
 int
 ps_set_lm(ps_decoder_t *ps, const char *name, ngram_model_t *lm)
 {
-    ps_search_t *search;
-    search = ngram_search_init(name, lm, ps->config, ps->acmod, ps->dict, ps->d2p);
+    return ps_set_lm_shared(ps, name, lm, NULL);
+}
+
+int
+ps_set_lm_shared(ps_decoder_t *ps, const char *name, ngram_model_t *lm,
+                 ps_decoder_t *other)
+{
+    ps_search_t *search, *other_search;
+
+    other_search = other ? ps_find_search(other, name) : NULL;
+    if (other_search
+        && 0 != strcmp(ps_search_type(other_search), PS_SEARCH_TYPE_NGRAM))
+        other_search = NULL;
+    search = ngram_search_init_shared(name, lm, ps->config, ps->acmod,
+                                      ps->dict, ps->d2p, other_search);
     return set_search_internal(ps, search);
 }
 
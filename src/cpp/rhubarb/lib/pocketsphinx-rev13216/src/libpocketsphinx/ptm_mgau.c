@@ -253,6 +253,88 @@ ptm_mgau_codebook_eval(ptm_mgau_t *s, mfcc_t **z, int frame)
     return 0;
 }
 
+/**
+ * Keep the top-N codewords of a newly evaluated frame in the utterance
+ * store, along with the top-N they were seeded from.  Scores are kept
+ * before normalization, since that depends on the set of active
+ * codebooks.
+ */
+static void
+ptm_mgau_store_save(ptm_mgau_t *s, ptm_fast_eval_t *lastf, int frame)
+{
+    ps_mgau_t *ps = ps_mgau_base(s);
+    size_t frame_size;
+    int i;
+
+    /* Only contiguous frames, and downsampled ones are not exact. */
+    if (frame != ps->n_stored_frame || s->ds_ratio != 1)
+        return;
+
+    frame_size = s->g->n_mgau * s->g->n_feat * s->max_topn;
+    if (frame >= s->n_store_alloc) {
+        s->n_store_alloc = s->n_store_alloc ? s->n_store_alloc * 2 : 256;
+        s->store = ckd_realloc(s->store, s->n_store_alloc * frame_size
+                               * sizeof(*s->store));
+        s->store_seed = ckd_realloc(s->store_seed, s->n_store_alloc
+                                    * frame_size * sizeof(*s->store_seed));
+        s->store_active = ckd_realloc(s->store_active,
+                                      s->n_store_alloc * s->g->n_mgau);
+    }
+    memcpy(s->store + frame * frame_size, s->f->topn[0][0],
+           frame_size * sizeof(*s->store));
+    memcpy(s->store_seed + frame * frame_size, lastf->topn[0][0],
+           frame_size * sizeof(*s->store_seed));
+    for (i = 0; i < s->g->n_mgau; ++i)
+        s->store_active[frame * s->g->n_mgau + i]
+            = bitvec_is_set(s->f->mgau_active, i) ? TRUE : FALSE;
+    ++ps->n_stored_frame;
+}
+
+/**
+ * Get the top-N codewords of a frame from the utterance store.
+ *
+ * The result of evaluating a codebook only depends on the frame, the
+ * top-N it starts from and whether the codebook is active, so a stored
+ * top-N is only reused when the current pass gives the same starting
+ * top-N and activity.  Other codebooks are evaluated exactly as
+ * ptm_mgau_codebook_eval() would and replace their stored entries.
+ */
+static int
+ptm_mgau_store_load(ptm_mgau_t *s, mfcc_t **z, int frame)
+{
+    ptm_topn_t *stored, *seed;
+    uint8 *active;
+    size_t cb_size;
+    int i, j;
+
+    cb_size = s->g->n_feat * s->max_topn;
+    stored = s->store + frame * s->g->n_mgau * cb_size;
+    seed = s->store_seed + frame * s->g->n_mgau * cb_size;
+    active = s->store_active + frame * s->g->n_mgau;
+
+    for (i = 0; i < s->g->n_mgau; ++i) {
+        uint8 is_active = bitvec_is_set(s->f->mgau_active, i) ? TRUE : FALSE;
+        if (active[i] == is_active
+            && memcmp(seed + i * cb_size, s->f->topn[i][0],
+                      cb_size * sizeof(*seed)) == 0) {
+            memcpy(s->f->topn[i][0], stored + i * cb_size,
+                   cb_size * sizeof(*stored));
+            continue;
+        }
+        memcpy(seed + i * cb_size, s->f->topn[i][0],
+               cb_size * sizeof(*seed));
+        for (j = 0; j < s->g->n_feat; ++j) {
+            eval_topn(s, i, j, z[j]);
+            if (is_active)
+                eval_cb(s, i, j, z[j]);
+        }
+        memcpy(stored + i * cb_size, s->f->topn[i][0],
+               cb_size * sizeof(*stored));
+        active[i] = is_active;
+    }
+    return 0;
+}
+
 /**
  * Normalize densities to produce "posterior probabilities",
  * i.e. things with a reasonable dynamic range, then scale and
@@ -402,6 +484,24 @@ ptm_mgau_senone_eval(ptm_mgau_t *s, int16 *senone_scores,
     return 0;
 }
 
+/**
+ * Initialize top-N codewords to sane (yet arbitrary) defaults.
+ */
+static void
+ptm_mgau_init_topn(ptm_mgau_t *s, ptm_fast_eval_t *f)
+{
+    int j, k, m;
+
+    for (j = 0; j < s->g->n_mgau; ++j) {
+        for (k = 0; k < s->g->n_feat; ++k) {
+            for (m = 0; m < s->max_topn; ++m) {
+                f->topn[j][k][m].cw = m;
+                f->topn[j][k][m].score = WORST_DIST;
+            }
+        }
+    }
+}
+
 /**
  * Compute senone scores for the active senones.
  */
@@ -429,6 +529,9 @@ ptm_mgau_frame_eval(ps_mgau_t *ps,
      * hope!) */
     if (frame >= ps_mgau_base(ps)->frame_idx) {
         ptm_fast_eval_t *lastf;
+        /* Generate initial active codebook list (this might not be
+         * necessary) */
+        ptm_mgau_calc_cb_active(s, senone_active, n_senone_active, compallsen);
         /* Get the previous frame's top-N information (on the
          * first frame of the input this is just all WORST_DIST,
          * no harm in that) */
@@ -436,14 +539,23 @@ ptm_mgau_frame_eval(ps_mgau_t *ps,
             lastf = s->hist + s->n_fast_hist - 1;
         else
             lastf = s->hist + fast_eval_idx - 1;
+        /* Don't start an utterance from the end of the previous one,
+         * so that its scores don't depend on what came before. */
+        if (frame == 0)
+            ptm_mgau_init_topn(s, lastf);
         /* Copy in initial top-N info */
         memcpy(s->f->topn[0][0], lastf->topn[0][0],
                s->g->n_mgau * s->g->n_feat * s->max_topn * sizeof(ptm_topn_t));
-        /* Generate initial active codebook list (this might not be
-         * necessary) */
-        ptm_mgau_calc_cb_active(s, senone_active, n_senone_active, compallsen);
-        /* Now evaluate top-N, prune, and evaluate remaining codebooks. */
-        ptm_mgau_codebook_eval(s, featbuf, frame);
+        if (frame < ps_mgau_base(ps)->n_stored_frame) {
+            /* An earlier pass over this utterance already evaluated
+             * this frame. */
+            ptm_mgau_store_load(s, featbuf, frame);
+        }
+        else {
+            /* Now evaluate top-N, prune, and evaluate remaining codebooks. */
+            ptm_mgau_codebook_eval(s, featbuf, frame);
+            ptm_mgau_store_save(s, lastf, frame);
+        }
         ptm_mgau_codebook_norm(s, featbuf, frame);
     }
     /* Evaluate intersection of active senones and active codebooks. */
@@ -766,6 +878,45 @@ read_mixw(ptm_mgau_t * s, char const *file_name, double SmoothMin)
     return n_sen;
 }
 
+static void
+ptm_mgau_alloc_hist(ptm_mgau_t *s)
+{
+    int i;
+
+    /* Allocate fast-match history buffers.  We need enough for the
+     * phoneme lookahead window, plus the current frame, plus one for
+     * good measure? (FIXME: I don't remember why) */
+    s->n_fast_hist = cmd_ln_int32_r(s->config, "-pl_window") + 2;
+    s->hist = ckd_calloc(s->n_fast_hist, sizeof(*s->hist));
+    /* s->f will be a rotating pointer into s->hist. */
+    s->f = s->hist;
+    for (i = 0; i < s->n_fast_hist; ++i) {
+        /* Top-N codewords for every codebook and feature. */
+        s->hist[i].topn = ckd_calloc_3d(s->g->n_mgau, s->g->n_feat,
+                                        s->max_topn, sizeof(ptm_topn_t));
+        ptm_mgau_init_topn(s, s->hist + i);
+        /* Active codebook mapping (just codebook, not features,
+           at least not yet) */
+        s->hist[i].mgau_active = bitvec_alloc(s->g->n_mgau);
+        /* Start with them all on, prune them later. */
+        bitvec_set_all(s->hist[i].mgau_active, s->g->n_mgau);
+    }
+}
+
+static void
+ptm_mgau_free_hist(ptm_mgau_t *s)
+{
+    int i;
+
+    for (i = 0; i < s->n_fast_hist; i++) {
+	ckd_free_3d(s->hist[i].topn);
+	bitvec_free(s->hist[i].mgau_active);
+    }
+    ckd_free(s->hist);
+    s->hist = NULL;
+    s->n_fast_hist = 0;
+}
+
 ps_mgau_t *
 ptm_mgau_init(acmod_t *acmod, bin_mdef_t *mdef)
 {
@@ -776,6 +927,7 @@ ptm_mgau_init(acmod_t *acmod, bin_mdef_t *mdef)
 
     s = ckd_calloc(1, sizeof(*s));
     s->config = acmod->config;
+    s->refcount = 1;
 
     s->lmath = logmath_retain(acmod->lmath);
     /* Log-add table. */
@@ -843,33 +995,7 @@ ptm_mgau_init(acmod_t *acmod, bin_mdef_t *mdef)
     for (i = 0; i < s->n_sen; ++i)
         s->sen2cb[i] = bin_mdef_sen2cimap(acmod->mdef, i);
 
-    /* Allocate fast-match history buffers.  We need enough for the
-     * phoneme lookahead window, plus the current frame, plus one for
-     * good measure? (FIXME: I don't remember why) */
-    s->n_fast_hist = cmd_ln_int32_r(s->config, "-pl_window") + 2;
-    s->hist = ckd_calloc(s->n_fast_hist, sizeof(*s->hist));
-    /* s->f will be a rotating pointer into s->hist. */
-    s->f = s->hist;
-    for (i = 0; i < s->n_fast_hist; ++i) {
-        int j, k, m;
-        /* Top-N codewords for every codebook and feature. */
-        s->hist[i].topn = ckd_calloc_3d(s->g->n_mgau, s->g->n_feat,
-                                        s->max_topn, sizeof(ptm_topn_t));
-        /* Initialize them to sane (yet arbitrary) defaults. */
-        for (j = 0; j < s->g->n_mgau; ++j) {
-            for (k = 0; k < s->g->n_feat; ++k) {
-                for (m = 0; m < s->max_topn; ++m) {
-                    s->hist[i].topn[j][k][m].cw = m;
-                    s->hist[i].topn[j][k][m].score = WORST_DIST;
-                }
-            }
-        }
-        /* Active codebook mapping (just codebook, not features,
-           at least not yet) */
-        s->hist[i].mgau_active = bitvec_alloc(s->g->n_mgau);
-        /* Start with them all on, prune them later. */
-        bitvec_set_all(s->hist[i].mgau_active, s->g->n_mgau);
-    }
+    ptm_mgau_alloc_hist(s);
 
     ps = (ps_mgau_t *)s;
     ps->vt = &ptm_mgau_funcs;
@@ -887,11 +1013,44 @@ ptm_mgau_mllr_transform(ps_mgau_t *ps,
     return gauden_mllr_transform(s->g, mllr, s->config);
 }
 
-void
-ptm_mgau_free(ps_mgau_t *ps)
+ps_mgau_t *
+ptm_mgau_copy(ps_mgau_t *other, cmd_ln_t *config)
 {
-    int i;
-    ptm_mgau_t *s = (ptm_mgau_t *)ps;
+    ptm_mgau_t *o = (ptm_mgau_t *)other;
+    ptm_mgau_t *s;
+
+    if (other->vt != &ptm_mgau_funcs)
+        return NULL;
+
+    s = ckd_calloc(1, sizeof(*s));
+    s->config = config;
+    s->model = o->model ? o->model : o;
+    ++s->model->refcount;
+
+    /* Shared, read-only model parameters. */
+    s->g = o->g;
+    s->n_sen = o->n_sen;
+    s->sen2cb = o->sen2cb;
+    s->mixw = o->mixw;
+    s->sendump_mmap = o->sendump_mmap;
+    s->mixw_cb = o->mixw_cb;
+    s->lmath_8b = o->lmath_8b;
+    s->lmath = o->lmath;
+
+    /* Private evaluation state. */
+    s->ds_ratio = cmd_ln_int32_r(s->config, "-ds");
+    s->max_topn = cmd_ln_int32_r(s->config, "-topn");
+    ptm_mgau_alloc_hist(s);
+
+    ps_mgau_base(s)->vt = &ptm_mgau_funcs;
+    return ps_mgau_base(s);
+}
+
+static void
+ptm_mgau_release_model(ptm_mgau_t *s)
+{
+    if (--s->refcount > 0)
+        return;
 
     logmath_free(s->lmath);
     logmath_free(s->lmath_8b);
@@ -904,12 +1063,21 @@ ptm_mgau_free(ps_mgau_t *ps)
     }
     ckd_free(s->sen2cb);
     
-    for (i = 0; i < s->n_fast_hist; i++) {
-	ckd_free_3d(s->hist[i].topn);
-	bitvec_free(s->hist[i].mgau_active);
-    }
-    ckd_free(s->hist);
-    
     gauden_free(s->g);
     ckd_free(s);
 }
+
+void
+ptm_mgau_free(ps_mgau_t *ps)
+{
+    ptm_mgau_t *s = (ptm_mgau_t *)ps;
+    ptm_mgau_t *model = s->model ? s->model : s;
+
+    ptm_mgau_free_hist(s);
+    ckd_free(s->store);
+    ckd_free(s->store_seed);
+    ckd_free(s->store_active);
+    if (s != model)
+        ckd_free(s);
+    ptm_mgau_release_model(model);
+}
@@ -81,13 +81,36 @@ struct ptm_mgau_s {
     ptm_fast_eval_t *f;      /**< Fast eval info for current frame. */
     int n_fast_hist;         /**< Number of past frames tracked. */
 
+    /* Top-N codewords of every frame of the utterance, so that further
+     * passes over the same frames (-fwdflat, alignment) don't evaluate
+     * the Gaussians again. */
+    ptm_topn_t *store;       /**< Unnormalized top-N (frame x mgau x feature x topn) */
+    ptm_topn_t *store_seed;  /**< Top-N each stored top-N started from */
+    uint8 *store_active;     /**< Codebooks fully evaluated (frame x mgau) */
+    int32 n_store_alloc;     /**< Number of frames allocated in store. */
+
     /* Log-add table for compressed values. */
     logmath_t *lmath_8b;
     /* Log-add object for reloading means/variances. */
     logmath_t *lmath;
+
+    /* Instance owning the model parameters (Gaussians, mixture
+     * weights, log-add tables), or NULL if this instance owns them. */
+    ptm_mgau_t *model;
+    /* Number of instances using the model parameters owned by this
+     * instance, including itself. */
+    int32 refcount;
 };
 
 ps_mgau_t *ptm_mgau_init(acmod_t *acmod, bin_mdef_t *mdef);
+/**
+ * Create a new instance that shares the (read-only) model parameters
+ * of an existing one.  Only the fast evaluation buffers are private
+ * to the new instance.
+ *
+ * @return NULL if <code>other</code> is not a PTM model.
+ */
+ps_mgau_t *ptm_mgau_copy(ps_mgau_t *other, cmd_ln_t *config);
 void ptm_mgau_free(ps_mgau_t *s);
 int ptm_mgau_frame_eval(ps_mgau_t *s,
                         int16 *senone_scores,
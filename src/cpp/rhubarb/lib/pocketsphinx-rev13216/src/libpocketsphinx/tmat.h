@@ -109,6 +109,7 @@ typedef struct {
     int16 n_tmat;	/**< Number matrices */
     int16 n_state;	/**< Number source states in matrix (only the emitting states);
 			   Number destination states = n_state+1, it includes the exit state */
+    int32 refcount;	/**< Reference count */
 } tmat_t;
 
 
@@ -129,6 +130,11 @@ void tmat_dump (tmat_t *tmat,  /**< In: transition matrix */
     );	
 
 
+/**
+ * Retain a pointer to a transition matrix.
+ */
+tmat_t *tmat_retain(tmat_t *t);
+
 /**
  * RAH, add code to remove memory allocated by tmat_init
  */
@@ -253,7 +253,7 @@ fe_init_auto_r(cmd_ln_t *config)
     }
 
     if (fe->dither)
-        fe_init_dither(fe->dither_seed);
+        fe_init_dither(fe);
 
     /* establish buffers for overflow samps and hamming window */
     fe->overflow_samps = ckd_calloc(fe->frame_size, sizeof(int16));
@@ -319,10 +319,10 @@ fe_get_config(fe_t *fe)
 }
 
 void
-fe_init_dither(int32 seed)
+fe_init_dither(fe_t *fe)
 {
-    E_INFO("Using %d as the seed.\n", seed);
-    s3_rand_seed(seed);
+    E_INFO("Using %d as the seed.\n", fe->dither_seed);
+    fe->rng = genrand_init(fe->dither_seed);
 }
 
 static void
@@ -341,6 +341,8 @@ fe_start_utt(fe_t * fe)
     memset(fe->overflow_samps, 0, fe->frame_size * sizeof(int16));
     fe->pre_emphasis_prior = 0;
     fe_reset_vad_data(fe->vad_data);
+    if (fe->rng)
+        genrand_seed_r(fe->rng, fe->dither_seed);
     return 0;
 }
 
@@ -656,6 +658,7 @@ fe_free(fe_t * fe)
     ckd_free(fe->mfspec);
     ckd_free(fe->overflow_samps);
     ckd_free(fe->hamming_window);
+    genrand_free(fe->rng);
 
     if (fe->noise_stats)
         fe_free_noisestats(fe->noise_stats);
@@ -44,6 +44,7 @@
 
 #include "sphinxbase/fe.h"
 #include "sphinxbase/fixpoint.h"
+#include "sphinxbase/genrand.h"
 
 #include "fe_noise.h"
 #include "fe_prespch_buf.h"
@@ -140,6 +141,9 @@ struct fe_s {
     float32 pre_emphasis_alpha;
     int16 pre_emphasis_prior;
     int32 dither_seed;
+    /* Dither generator, reseeded for each utterance, so that the
+     * features of an utterance don't depend on earlier ones. */
+    genrand_t *rng;
 
     int16 num_overflow_samps;    
     size_t num_processed_samps;
@@ -169,7 +173,7 @@ struct fe_s {
     int16 *overflow_samps;
 };
 
-void fe_init_dither(int32 seed);
+void fe_init_dither(fe_t *fe);
 
 /* Apply 1/2 bit noise to a buffer of audio. */
 int32 fe_dither(int16 *buffer, int32 nsamps);
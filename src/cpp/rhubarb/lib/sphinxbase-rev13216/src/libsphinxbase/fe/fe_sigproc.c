@@ -834,7 +834,7 @@ fe_read_frame(fe_t * fe, int16 const *in, int32 len)
             SWAP_INT16(&fe->spch[i]);
     if (fe->dither)
         for (i = 0; i < len; ++i)
-            fe->spch[i] += (int16) ((!(s3_rand_int31() % 4)) ? 1 : 0);
+            fe->spch[i] += (int16) ((!(genrand_int31_r(fe->rng) % 4)) ? 1 : 0);
 
     return fe_spch_to_frame(fe, len);
 }
@@ -859,7 +859,7 @@ fe_shift_frame(fe_t * fe, int16 const *in, int32 len)
     if (fe->dither)
         for (i = 0; i < len; ++i)
             fe->spch[offset + i]
-                += (int16) ((!(s3_rand_int31() % 4)) ? 1 : 0);
+                += (int16) ((!(genrand_int31_r(fe->rng) % 4)) ? 1 : 0);
 
     return fe_spch_to_frame(fe, offset + len);
 }
@@ -48,6 +48,10 @@
 #include "lm_trie_quant.h"
 
 static void lm_trie_alloc_ngram(lm_trie_t * trie, uint32 * counts, int order);
+static size_t lm_trie_ngram_size(lm_trie_t * trie, uint32 * counts,
+                                 int order);
+static void lm_trie_init_ngram(lm_trie_t * trie, uint32 * counts, int order,
+                               uint8 * mem);
 
 static uint32
 base_size(uint32 entries, uint32 max_vocab, uint8 remaining_bits)
@@ -367,10 +371,17 @@ lm_trie_init(uint32 unigram_count)
 
 lm_trie_t *
 lm_trie_create(uint32 unigram_count, int order)
+{
+    return lm_trie_create_quant(unigram_count, order,
+                                LM_TRIE_QUANT_DEFAULT_BITS);
+}
+
+lm_trie_t *
+lm_trie_create_quant(uint32 unigram_count, int order, int quant_bits)
 {
     lm_trie_t *trie = lm_trie_init(unigram_count);
     trie->quant =
-        (order > 1) ? lm_trie_quant_create(order) : 0;
+        (order > 1) ? lm_trie_quant_create_bits(order, quant_bits) : 0;
     return trie;
 }
 
@@ -379,6 +390,10 @@ lm_trie_read_bin(uint32 * counts, int order, FILE * fp)
 {
     lm_trie_t *trie = lm_trie_init(counts[0]);
     trie->quant = (order > 1) ? lm_trie_quant_read_bin(fp, order) : NULL;
+    if (order > 1 && trie->quant == NULL) {
+        lm_trie_free(trie);
+        return NULL;
+    }
     fread(trie->unigrams, sizeof(*trie->unigrams), (counts[0] + 1), fp);
     if (order > 1) {
         lm_trie_alloc_ngram(trie, counts, order);
@@ -387,6 +402,47 @@ lm_trie_read_bin(uint32 * counts, int order, FILE * fp)
     return trie;
 }
 
+lm_trie_t *
+lm_trie_map_bin(uint32 * counts, int order, uint8 const *data, size_t size,
+                size_t * n_used)
+{
+    lm_trie_t *trie;
+    size_t offset = 0;
+    size_t unigram_size = (counts[0] + 1) * sizeof(*trie->unigrams);
+
+    trie = (lm_trie_t *) ckd_calloc(1, sizeof(*trie));
+    memset(trie->hist_cache, -1, sizeof(trie->hist_cache));
+    trie->mapped = TRUE;
+    if (order > 1) {
+        if ((trie->quant =
+             lm_trie_quant_map_bin(data, size, order, &offset)) == NULL) {
+            lm_trie_free(trie);
+            return NULL;
+        }
+    }
+    if (((size_t) (data + offset)) % sizeof(float) != 0
+        || size - offset < unigram_size) {
+        E_ERROR("Unigrams are truncated or not aligned\n");
+        lm_trie_free(trie);
+        return NULL;
+    }
+    trie->unigrams = (unigram_t *) (data + offset);
+    offset += unigram_size;
+    if (order > 1) {
+        trie->ngram_mem_size = lm_trie_ngram_size(trie, counts, order);
+        if (size - offset < trie->ngram_mem_size) {
+            E_ERROR("N-grams are truncated\n");
+            lm_trie_free(trie);
+            return NULL;
+        }
+        /* N-grams are only written while building, so this is read-only */
+        lm_trie_init_ngram(trie, counts, order, (uint8 *) (data + offset));
+        offset += trie->ngram_mem_size;
+    }
+    *n_used = offset;
+    return trie;
+}
+
 void
 lm_trie_write_bin(lm_trie_t * trie, uint32 unigram_count, FILE * fp)
 {
@@ -403,35 +459,44 @@ void
 lm_trie_free(lm_trie_t * trie)
 {
     if (trie->ngram_mem) {
-        ckd_free(trie->ngram_mem);
+        if (!trie->mapped)
+            ckd_free(trie->ngram_mem);
         ckd_free(trie->middle_begin);
         ckd_free(trie->longest);
     }
     if (trie->quant)
         lm_trie_quant_free(trie->quant);
-    ckd_free(trie->unigrams);
+    if (!trie->mapped)
+        ckd_free(trie->unigrams);
     ckd_free(trie);
 }
 
-static void
-lm_trie_alloc_ngram(lm_trie_t * trie, uint32 * counts, int order)
+static size_t
+lm_trie_ngram_size(lm_trie_t * trie, uint32 * counts, int order)
 {
     int i;
-    uint8 *mem_ptr;
-    uint8 **middle_starts;
+    size_t ngram_mem_size = 0;
 
-    trie->ngram_mem_size = 0;
     for (i = 1; i < order - 1; i++) {
-        trie->ngram_mem_size +=
+        ngram_mem_size +=
             middle_size(lm_trie_quant_msize(trie->quant), counts[i],
                         counts[0], counts[i + 1]);
     }
-    trie->ngram_mem_size +=
+    ngram_mem_size +=
         longest_size(lm_trie_quant_lsize(trie->quant), counts[order - 1],
                      counts[0]);
-    trie->ngram_mem =
-        (uint8 *) ckd_calloc(trie->ngram_mem_size,
-                             sizeof(*trie->ngram_mem));
+    return ngram_mem_size;
+}
+
+static void
+lm_trie_init_ngram(lm_trie_t * trie, uint32 * counts, int order,
+                   uint8 * mem)
+{
+    int i;
+    uint8 *mem_ptr;
+    uint8 **middle_starts;
+
+    trie->ngram_mem = mem;
     mem_ptr = trie->ngram_mem;
     trie->middle_begin =
         (middle_t *) ckd_calloc(order - 2, sizeof(*trie->middle_begin));
@@ -461,6 +526,15 @@ lm_trie_alloc_ngram(lm_trie_t * trie, uint32 * counts, int order)
                  counts[0]);
 }
 
+static void
+lm_trie_alloc_ngram(lm_trie_t * trie, uint32 * counts, int order)
+{
+    trie->ngram_mem_size = lm_trie_ngram_size(trie, counts, order);
+    lm_trie_init_ngram(trie, counts, order,
+                       (uint8 *) ckd_calloc(trie->ngram_mem_size,
+                                            sizeof(*trie->ngram_mem)));
+}
+
 void
 lm_trie_build(lm_trie_t * trie, ngram_raw_t ** raw_ngrams, uint32 * counts, uint32 *out_counts,
               int order)
@@ -860,3 +934,96 @@ lm_trie_fill_raw_ngram(lm_trie_t * trie,
         }
     }
 }
+
+static void
+lm_trie_visit_range(lm_trie_t * trie, node_range_t range, uint32 * hist,
+                    int n_hist, int max_order, uint8 const *filter,
+                    lm_trie_ngram_func_t func, void *data)
+{
+    uint32 words[NGRAM_MAX_ORDER];
+    uint32 ptr;
+    int i;
+
+    /* Callers bound max_order by the order of the trie. */
+    if (n_hist >= max_order || n_hist >= NGRAM_MAX_ORDER)
+        return;
+
+    for (ptr = range.begin; ptr < range.end; ptr++) {
+        bitarr_address_t address;
+        node_range_t node;
+        float prob, backoff;
+
+        node.begin = node.end = 0;
+        /* The layer depends on the order of the trie, not the visited one. */
+        if (n_hist - 1 == trie->middle_end - trie->middle_begin) {
+            longest_t *longest = trie->longest;
+            address.base = longest->base.base;
+            address.offset = ptr * longest->base.total_bits;
+            hist[n_hist] =
+                bitarr_read_int25(address, longest->base.word_bits,
+                                  longest->base.word_mask);
+            if (filter && !filter[hist[n_hist]])
+                continue;
+            address.offset += longest->base.word_bits;
+            prob = lm_trie_quant_lpread(trie->quant, address);
+            backoff = 0.0f;
+        }
+        else {
+            middle_t *middle = &trie->middle_begin[n_hist - 1];
+            address.base = middle->base.base;
+            address.offset = ptr * middle->base.total_bits;
+            hist[n_hist] =
+                bitarr_read_int25(address, middle->base.word_bits,
+                                  middle->base.word_mask);
+            /* Longer n-grams below this one contain the same word. */
+            if (filter && !filter[hist[n_hist]])
+                continue;
+            address.offset += middle->base.word_bits;
+            prob = lm_trie_quant_mpread(trie->quant, address, n_hist - 1);
+            backoff = lm_trie_quant_mboread(trie->quant, address, n_hist - 1);
+            address.offset += middle->quant_bits;
+            node.begin =
+                bitarr_read_int25(address, middle->next_mask.bits,
+                                  middle->next_mask.mask);
+            address.offset += middle->base.total_bits;
+            node.end =
+                bitarr_read_int25(address, middle->next_mask.bits,
+                                  middle->next_mask.mask);
+        }
+
+        for (i = 0; i <= n_hist; i++)
+            words[i] = hist[n_hist - i];
+        func(data, words, n_hist + 1, prob, backoff);
+
+        if (node.begin < node.end && n_hist + 1 < max_order)
+            lm_trie_visit_range(trie, node, hist, n_hist + 1, max_order,
+                                filter, func, data);
+    }
+}
+
+void
+lm_trie_visit_ngrams(lm_trie_t * trie, uint32 unigram_count, int max_order,
+                     uint8 const *filter, lm_trie_ngram_func_t func,
+                     void *data)
+{
+    uint32 hist[NGRAM_MAX_ORDER];
+    node_range_t node;
+    unigram_t *unigram;
+    uint32 word;
+    int trie_order;
+
+    trie_order = trie->ngram_mem
+        ? (int) (trie->middle_end - trie->middle_begin) + 2 : 1;
+    if (max_order > trie_order)
+        max_order = trie_order;
+    for (word = 0; word < unigram_count; word++) {
+        if (filter && !filter[word])
+            continue;
+        unigram = unigram_find(trie->unigrams, word, &node);
+        hist[0] = word;
+        func(data, hist, 1, unigram->prob, unigram->bo);
+        if (max_order > 1)
+            lm_trie_visit_range(trie, node, hist, 1, max_order, filter,
+                                func, data);
+    }
+}
@@ -84,6 +84,7 @@ typedef struct lm_trie_s {
     middle_t *middle_end;
     longest_t *longest;
     lm_trie_quant_t *quant;
+    int mapped;    /**< Unigrams and n-grams point into a binary image */
 
     float backoff_cache[NGRAM_MAX_ORDER];
     uint32 hist_cache[NGRAM_MAX_ORDER - 1];
@@ -94,8 +95,24 @@ typedef struct lm_trie_s {
  */
 lm_trie_t *lm_trie_create(uint32 unigram_count, int order);
 
+/**
+ * Creates lm_trie structure that quantizes n-gram weights to the given
+ * number of bits (see lm_trie_quant_create_bits()).
+ */
+lm_trie_t *lm_trie_create_quant(uint32 unigram_count, int order,
+                                int quant_bits);
+
 lm_trie_t *lm_trie_read_bin(uint32 * counts, int order, FILE * fp);
 
+/**
+ * Creates lm_trie structure whose weights and n-grams point into a binary
+ * image, as written by lm_trie_write_bin(), instead of copying them.  The
+ * image must stay valid until the trie is freed.  Sets n_used to the number
+ * of bytes used.  Returns NULL if the image is truncated or misaligned.
+ */
+lm_trie_t *lm_trie_map_bin(uint32 * counts, int order, uint8 const *data,
+                           size_t size, size_t * n_used);
+
 void lm_trie_write_bin(lm_trie_t * trie, uint32 unigram_count, FILE * fp);
 
 void lm_trie_free(lm_trie_t * trie);
@@ -111,4 +128,22 @@ void lm_trie_fill_raw_ngram(lm_trie_t * trie,
 float lm_trie_score(lm_trie_t * trie, int order, int32 wid, int32 * hist,
                     int32 n_hist, int32 * n_used);
 
+/**
+ * Callback for lm_trie_visit_ngrams(). Words are in text order, the
+ * probability and backoff weight in log domain.
+ */
+typedef void (*lm_trie_ngram_func_t) (void *data, uint32 const *words,
+                                      int n, float prob, float backoff);
+
+/**
+ * Calls a function for each n-gram of order 1 up to max_order. Orders
+ * beyond the order of the trie are skipped. If filter is given, only
+ * n-grams consisting of words with a nonzero filter entry are visited.
+ * The n-grams ending with a word are visited together, since the trie
+ * stores n-grams by their last word.
+ */
+void lm_trie_visit_ngrams(lm_trie_t * trie, uint32 unigram_count,
+                          int max_order, uint8 const *filter,
+                          lm_trie_ngram_func_t func, void *data);
+
 #endif                          /* __LM_TRIE_H__ */
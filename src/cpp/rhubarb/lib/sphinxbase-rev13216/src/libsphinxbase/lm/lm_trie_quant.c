@@ -36,6 +36,7 @@
  */
 
 #include <math.h>
+#include <string.h>
 
 #include <sphinxbase/prim_type.h>
 #include <sphinxbase/ckd_alloc.h>
@@ -56,6 +57,7 @@ struct lm_trie_quant_s {
     bins_t *longest;
     uint8 *mem;
     size_t mem_size;
+    int mapped;     /**< mem points into a binary image owned by the caller */
     uint8 prob_bits;
     uint8 bo_bits;
     uint32 prob_mask;
@@ -109,29 +111,28 @@ bins_decode(bins_t * bins, size_t off)
 }
 
 static size_t
-quant_size(int order)
+quant_size(int order, int bits)
 {
-    int prob_bits = 16;
-    int bo_bits = 16;
+    int prob_bits = bits;
+    int bo_bits = bits;
     size_t longest_table = (1U << prob_bits) * sizeof(float);
     size_t middle_table = (1U << bo_bits) * sizeof(float) + longest_table;
     /* unigrams are currently not quantized so no need for a table. */
     return (order - 2) * middle_table + longest_table;
 }
 
-lm_trie_quant_t *
-lm_trie_quant_create(int order)
+static lm_trie_quant_t *
+lm_trie_quant_init(int order, int bits, uint8 * mem)
 {
     float *start;
     int i;
     lm_trie_quant_t *quant =
         (lm_trie_quant_t *) ckd_calloc(1, sizeof(*quant));
-    quant->mem_size = quant_size(order);
-    quant->mem =
-        (uint8 *) ckd_calloc(quant->mem_size, sizeof(*quant->mem));
+    quant->mem_size = quant_size(order, bits);
+    quant->mem = mem;
 
-    quant->prob_bits = 16;
-    quant->bo_bits = 16;
+    quant->prob_bits = bits;
+    quant->bo_bits = bits;
     quant->prob_mask = (1U << quant->prob_bits) - 1;
     quant->bo_mask = (1U << quant->bo_bits) - 1;
 
@@ -147,33 +148,95 @@ lm_trie_quant_create(int order)
     return quant;
 }
 
+/*
+ * The binary format stores the number of bits in place of the former
+ * quantization type.  Type 1 stands for the original 16 bits, so files
+ * with 16 bits stay unchanged.
+ */
+static int
+quant_bits_from_type(int type)
+{
+    if (type == 1)
+        return LM_TRIE_QUANT_DEFAULT_BITS;
+    if (type < LM_TRIE_QUANT_MIN_BITS || type > LM_TRIE_QUANT_MAX_BITS)
+        return -1;
+    return type;
+}
+
+lm_trie_quant_t *
+lm_trie_quant_create(int order)
+{
+    return lm_trie_quant_create_bits(order, LM_TRIE_QUANT_DEFAULT_BITS);
+}
+
+lm_trie_quant_t *
+lm_trie_quant_create_bits(int order, int bits)
+{
+    return lm_trie_quant_init(order, bits,
+                              (uint8 *) ckd_calloc(quant_size(order, bits),
+                                                   sizeof(uint8)));
+}
 
 lm_trie_quant_t *
 lm_trie_quant_read_bin(FILE * fp, int order)
 {
-    int dummy;
+    int type, bits;
     lm_trie_quant_t *quant;
 
-    fread(&dummy, sizeof(dummy), 1, fp);
-    quant = lm_trie_quant_create(order);
+    fread(&type, sizeof(type), 1, fp);
+    if ((bits = quant_bits_from_type(type)) < 0) {
+        E_ERROR("Unsupported quantization type %d\n", type);
+        return NULL;
+    }
+    quant = lm_trie_quant_create_bits(order, bits);
     fread(quant->mem, sizeof(*quant->mem), quant->mem_size, fp);
 
     return quant;
 }
 
+lm_trie_quant_t *
+lm_trie_quant_map_bin(uint8 const *data, size_t size, int order,
+                      size_t * n_used)
+{
+    lm_trie_quant_t *quant;
+    int type, bits;
+    size_t offset = sizeof(type);
+
+    if (size < offset)
+        return NULL;
+    memcpy(&type, data, sizeof(type));
+    if ((bits = quant_bits_from_type(type)) < 0) {
+        E_ERROR("Unsupported quantization type %d\n", type);
+        return NULL;
+    }
+    if (((size_t) (data + offset)) % sizeof(float) != 0) {
+        E_ERROR("Quantization tables are not aligned\n");
+        return NULL;
+    }
+    if (size - offset < quant_size(order, bits)) {
+        E_ERROR("Quantization tables are truncated\n");
+        return NULL;
+    }
+    quant = lm_trie_quant_init(order, bits, (uint8 *) (data + offset));
+    quant->mapped = TRUE;
+    *n_used = offset + quant->mem_size;
+    return quant;
+}
+
 void
 lm_trie_quant_write_bin(lm_trie_quant_t * quant, FILE * fp)
 {
     /* Before it was quantization type */
-    int dummy = 1;
-    fwrite(&dummy, sizeof(dummy), 1, fp);
+    int type = (quant->prob_bits == LM_TRIE_QUANT_DEFAULT_BITS)
+        ? 1 : quant->prob_bits;
+    fwrite(&type, sizeof(type), 1, fp);
     fwrite(quant->mem, sizeof(*quant->mem), quant->mem_size, fp);
 }
 
 void
 lm_trie_quant_free(lm_trie_quant_t * quant)
 {
-    if (quant->mem)
+    if (quant->mem && !quant->mapped)
         ckd_free(quant->mem);
     ckd_free(quant);
 }
@@ -181,13 +244,13 @@ lm_trie_quant_free(lm_trie_quant_t * quant)
 uint8
 lm_trie_quant_msize(lm_trie_quant_t * quant)
 {
-    return 32;
+    return quant->prob_bits + quant->bo_bits;
 }
 
 uint8
 lm_trie_quant_lsize(lm_trie_quant_t * quant)
 {
-    return 16;
+    return quant->prob_bits;
 }
 
 static int
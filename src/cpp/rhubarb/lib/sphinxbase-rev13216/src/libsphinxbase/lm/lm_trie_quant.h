@@ -43,16 +43,36 @@
 
 typedef struct lm_trie_quant_s lm_trie_quant_t;
 
+/** Bits per quantized weight of the original binary format */
+#define LM_TRIE_QUANT_DEFAULT_BITS 16
+#define LM_TRIE_QUANT_MIN_BITS 2
+#define LM_TRIE_QUANT_MAX_BITS 16
+
 /**
  * Create qunatizing
  */
 lm_trie_quant_t *lm_trie_quant_create(int order);
 
+/**
+ * Create quantizing with the given number of bits per probability and
+ * backoff weight, between LM_TRIE_QUANT_MIN_BITS and LM_TRIE_QUANT_MAX_BITS.
+ * Fewer bits make a smaller trie with coarser weights.
+ */
+lm_trie_quant_t *lm_trie_quant_create_bits(int order, int bits);
+
 /**
  * Write quant data to binary file
  */
 lm_trie_quant_t *lm_trie_quant_read_bin(FILE * fp, int order);
 
+/**
+ * Create quant whose tables point into a binary image, as written by
+ * lm_trie_quant_write_bin().  The image must stay valid until the quant
+ * is freed.  Sets n_used to the number of bytes used.
+ */
+lm_trie_quant_t *lm_trie_quant_map_bin(uint8 const *data, size_t size,
+                                       int order, size_t * n_used);
+
 /**
  * Write quant data to binary file
  */
@@ -48,6 +48,7 @@
 #include "sphinxbase/filename.h"
 
 #include "ngram_model_set.h"
+#include "ngram_model_trie.h"
 
 static ngram_funcs_t ngram_model_set_funcs;
 
@@ -364,6 +365,12 @@ ngram_model_set_read(cmd_ln_t * config,
     return set;
 }
 
+int
+ngram_model_is_set(ngram_model_t * base)
+{
+    return base->funcs == &ngram_model_set_funcs;
+}
+
 int32
 ngram_model_set_count(ngram_model_t * base)
 {
@@ -638,9 +645,47 @@ ngram_model_set_remove(ngram_model_t * base,
 void
 ngram_model_set_map_words(ngram_model_t * base,
                           const char **words, int32 n_words)
+{
+    ngram_model_set_map_words_shared(base, words, n_words, NULL);
+}
+
+/*
+ * Whether the models of two sets have the same vocabularies, so that
+ * their word mappings are interchangeable.
+ */
+static int
+same_vocabularies(ngram_model_set_t * set, ngram_model_t * other)
+{
+    ngram_model_set_t *other_set = (ngram_model_set_t *) other;
+    int32 j;
+
+    if (other == NULL || other->funcs != &ngram_model_set_funcs
+        || other_set->n_models != set->n_models)
+        return FALSE;
+    for (j = 0; j < set->n_models; ++j) {
+        if (set->lms[j] == other_set->lms[j])
+            continue;
+        /* Words may have been added to either model after reading it */
+        if (!ngram_model_trie_same_bin(set->lms[j], other_set->lms[j])
+            || set->lms[j]->n_words != other_set->lms[j]->n_words)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+void
+ngram_model_set_map_words_shared(ngram_model_t * base,
+                                 const char **words, int32 n_words,
+                                 ngram_model_t * other)
 {
     ngram_model_set_t *set = (ngram_model_set_t *) base;
-    int32 i;
+    int32 i, n_shared;
+
+    /* Words at the same position in both mappings are usually the
+     * same, e.g. those of a shared compiled dictionary. */
+    n_shared = 0;
+    if (same_vocabularies(set, other))
+        n_shared = other->n_words < n_words ? other->n_words : n_words;
 
     /* Recreate the word mapping. */
     if (base->writable) {
@@ -656,11 +701,25 @@ ngram_model_set_map_words(ngram_model_t * base,
     set->widmap =
         (int32 **) ckd_calloc_2d(n_words, set->n_models,
                                  sizeof(**set->widmap));
-    hash_table_empty(base->wid);
+    /* The table was sized for the vocabulary of the models, which can
+     * be much smaller than a dictionary.  Overfull buckets make every
+     * insertion walk a long collision list. */
+    if (n_words > base->wid->size) {
+        hash_table_free(base->wid);
+        base->wid = hash_table_new(n_words, HASH_CASE_YES);
+    }
+    else
+        hash_table_empty(base->wid);
     for (i = 0; i < n_words; ++i) {
         int32 j;
         base->word_str[i] = ckd_salloc(words[i]);
         (void) hash_table_enter_int32(base->wid, base->word_str[i], i);
+        if (i < n_shared && 0 == strcmp(words[i], other->word_str[i])) {
+            memcpy(set->widmap[i],
+                   ((ngram_model_set_t *) other)->widmap[i],
+                   set->n_models * sizeof(**set->widmap));
+            continue;
+        }
         for (j = 0; j < set->n_models; ++j) {
             set->widmap[i][j] = ngram_wid(set->lms[j], base->word_str[i]);
         }
@@ -700,6 +759,11 @@ ngram_model_set_score(ngram_model_t * base, int32 wid,
             int32 j;
             /* Map word and history IDs for each model. */
             mapwid = set->widmap[wid][i];
+            /* A model without the word adds nothing, as its score
+             * would be zero.  Skipping it spares a lookup for every
+             * word that only some of the models know. */
+            if (mapwid == NGRAM_INVALID_WID)
+                continue;
             for (j = 0; j < n_hist; ++j) {
                 if (history[j] == NGRAM_INVALID_WID)
                     set->maphist[j] = NGRAM_INVALID_WID;
@@ -750,6 +814,8 @@ ngram_model_set_raw_score(ngram_model_t * base, int32 wid,
             int32 j;
             /* Map word and history IDs for each model. */
             mapwid = set->widmap[wid][i];
+            if (mapwid == NGRAM_INVALID_WID)
+                continue;
             for (j = 0; j < n_hist; ++j) {
                 if (history[j] == NGRAM_INVALID_WID)
                     set->maphist[j] = NGRAM_INVALID_WID;
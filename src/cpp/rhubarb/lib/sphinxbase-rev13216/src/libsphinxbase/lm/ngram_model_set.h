@@ -59,6 +59,22 @@ typedef struct ngram_model_set_s {
     int32 *maphist;      /**< Word ID mapping for N-Gram history. */
 } ngram_model_set_t;
 
+/**
+ * Set the word-to-ID mapping for this model set, like
+ * ngram_model_set_map_words(), but copy the mapping of words that the
+ * other set already mapped to models with the same vocabulary.  This
+ * avoids looking up every word of a large dictionary again when several
+ * sets use the same dictionary and language model.
+ */
+void ngram_model_set_map_words_shared(ngram_model_t * set,
+                                      const char **words, int32 n_words,
+                                      ngram_model_t * other /**< May be NULL */);
+
+/**
+ * Check whether a language model is a model set.
+ */
+int ngram_model_is_set(ngram_model_t * model);
+
 /**
  * Iterator over a model set.
  */
@@ -43,6 +43,7 @@
 #include <sphinxbase/strfuncs.h>
 #include <sphinxbase/ckd_alloc.h>
 #include <sphinxbase/byteorder.h>
+#include <sphinxbase/mmio.h>
 
 #include "ngram_model_trie.h"
 
@@ -50,6 +51,13 @@ static const char trie_hdr[] = "Trie Language Model";
 static const char dmp_hdr[] = "Darpa Trigram LM";
 static ngram_funcs_t ngram_model_trie_funcs;
 
+struct ngram_trie_bin_s {
+    int refcnt;
+    char *path;
+    mmio_file_t *mf;
+    size_t size;
+};
+
 /*
  * Read and return #unigrams, #bigrams, #trigrams as stated in input file.
  */
@@ -228,6 +236,87 @@ ngram_model_trie_read_arpa(cmd_ln_t * config,
     return base;
 }
 
+/* Set weights based on config, as ngram_model_read() does. */
+static void
+apply_config_weights(ngram_model_t * base, cmd_ln_t * config)
+{
+    float32 lw = 1.0;
+    float32 wip = 1.0;
+
+    if (config == NULL)
+        return;
+    if (cmd_ln_exists_r(config, "-lw"))
+        lw = cmd_ln_float32_r(config, "-lw");
+    if (cmd_ln_exists_r(config, "-wip"))
+        wip = cmd_ln_float32_r(config, "-wip");
+    ngram_model_apply_weights(base, lw, wip);
+}
+
+ngram_model_t *
+ngram_model_trie_build(cmd_ln_t * config, logmath_t * lmath,
+                       int order, uint32 * counts,
+                       char const *const *word_str, float32 const *ug_prob,
+                       float32 const *ug_bo, ngram_raw_t ** raw_ngrams)
+{
+    return ngram_model_trie_build_quant(config, lmath, order, counts,
+                                        word_str, ug_prob, ug_bo,
+                                        raw_ngrams,
+                                        LM_TRIE_QUANT_DEFAULT_BITS);
+}
+
+ngram_model_t *
+ngram_model_trie_build_quant(cmd_ln_t * config, logmath_t * lmath,
+                             int order, uint32 * counts,
+                             char const *const *word_str,
+                             float32 const *ug_prob, float32 const *ug_bo,
+                             ngram_raw_t ** raw_ngrams, int quant_bits)
+{
+    ngram_model_trie_t *model;
+    ngram_model_t *base;
+    uint32 i;
+    int n;
+
+    model = (ngram_model_trie_t *) ckd_calloc(1, sizeof(*model));
+    base = &model->base;
+    ngram_model_init(base, &ngram_model_trie_funcs, lmath, order,
+                     (int32) counts[0]);
+    base->writable = TRUE;
+
+    model->trie = lm_trie_create_quant(counts[0], order, quant_bits);
+    for (i = 0; i < counts[0]; i++) {
+        unigram_t *unigram = &model->trie->unigrams[i];
+        unigram->prob = logmath_log10_to_log_float(lmath, ug_prob[i]);
+        unigram->bo = logmath_log10_to_log_float(lmath, ug_bo[i]);
+        base->word_str[i] = ckd_salloc(word_str[i]);
+        if ((hash_table_enter
+             (base->wid, base->word_str[i],
+              (void *) (long) i)) != (void *) (long) i) {
+            E_WARN("Duplicate word in dictionary: %s\n",
+                   base->word_str[i]);
+        }
+    }
+
+    if (order > 1) {
+        /* Same conversions as when reading ARPA n-grams */
+        for (n = 2; n <= order; n++) {
+            ngram_raw_t *raw_ngram = raw_ngrams[n - 2];
+            for (i = 0; i < counts[n - 1]; i++) {
+                raw_ngram[i].order = n;
+                raw_ngram[i].prob =
+                    logmath_log10_to_log_float(lmath, raw_ngram[i].prob);
+                raw_ngram[i].backoff = (n == order) ? 0.0f
+                    : logmath_log10_to_log_float(lmath, raw_ngram[i].backoff);
+            }
+            qsort(raw_ngram, counts[n - 1], sizeof(*raw_ngram),
+                  &ngram_ord_comparator);
+        }
+        lm_trie_build(model->trie, raw_ngrams, counts, base->n_counts, order);
+    }
+
+    apply_config_weights(base, config);
+    return base;
+}
+
 int
 ngram_model_trie_write_arpa(ngram_model_t * base, const char *path)
 {
@@ -337,9 +426,110 @@ read_word_str(ngram_model_t * base, FILE * fp)
     free(tmp_word_str);
 }
 
-ngram_model_t *
-ngram_model_trie_read_bin(cmd_ln_t * config,
-                          const char *path, logmath_t * lmath)
+static ngram_trie_bin_t *
+ngram_trie_bin_map(const char *path, size_t size)
+{
+    ngram_trie_bin_t *bin;
+
+    bin = (ngram_trie_bin_t *) ckd_calloc(1, sizeof(*bin));
+    bin->refcnt = 1;
+    if ((bin->mf = mmio_file_read(path)) == NULL) {
+        ckd_free(bin);
+        return NULL;
+    }
+    bin->path = ckd_salloc(path);
+    bin->size = size;
+    return bin;
+}
+
+static void
+ngram_trie_bin_free(ngram_trie_bin_t * bin)
+{
+    if (bin == NULL || --bin->refcnt > 0)
+        return;
+    mmio_file_unmap(bin->mf);
+    ckd_free(bin->path);
+    ckd_free(bin);
+}
+
+/* Points word strings into the mapped file.  They are never freed. */
+static int
+map_word_str(ngram_model_t * base, char const *data, size_t size)
+{
+    int32 k;
+    uint32 i, j;
+
+    if (size < sizeof(k))
+        return -1;
+    memcpy(&k, data, sizeof(k));
+    data += sizeof(k);
+    if (k < 0 || size - sizeof(k) < (size_t) k)
+        return -1;
+
+    base->writable = FALSE;
+    for (i = 0, j = 0; i < base->n_counts[0]; i++) {
+        char const *end;
+        if (j >= (uint32) k
+            || (end = memchr(data + j, '\0', (size_t) k - j)) == NULL)
+            return -1;
+        base->word_str[i] = (char *) (data + j);
+        if (hash_table_enter(base->wid, base->word_str[i],
+                             (void *) (long) i) != (void *) (long) i) {
+            E_WARN("Duplicate word in dictionary: %s\n",
+                   base->word_str[i]);
+        }
+        j = (uint32) (end - data) + 1;
+    }
+    return 0;
+}
+
+/* Creates a model pointing into a binary file that was already mapped. */
+static ngram_model_t *
+ngram_model_trie_map_bin(ngram_trie_bin_t * bin, logmath_t * lmath)
+{
+    uint8 const *data = (uint8 const *) mmio_file_ptr(bin->mf);
+    size_t offset = strlen(trie_hdr);
+    size_t n_used;
+    uint8 i, order;
+    uint32 counts[NGRAM_MAX_ORDER];
+    ngram_model_trie_t *model;
+    ngram_model_t *base;
+
+    if (bin->size < offset + 1)
+        return NULL;
+    order = data[offset++];
+    if (order < 1 || order > NGRAM_MAX_ORDER
+        || bin->size < offset + order * sizeof(*counts))
+        return NULL;
+    for (i = 0; i < order; i++) {
+        memcpy(&counts[i], data + offset, sizeof(counts[i]));
+        offset += sizeof(counts[i]);
+    }
+
+    model = (ngram_model_trie_t *) ckd_calloc(1, sizeof(*model));
+    base = &model->base;
+    ngram_model_init(base, &ngram_model_trie_funcs, lmath, order,
+                     (int32) counts[0]);
+    for (i = 0; i < order; i++) {
+        base->n_counts[i] = counts[i];
+    }
+    model->bin = bin;
+    ++bin->refcnt;
+    if ((model->trie = lm_trie_map_bin(counts, order, data + offset,
+                                       bin->size - offset,
+                                       &n_used)) == NULL
+        || map_word_str(base, (char const *) data + offset + n_used,
+                        bin->size - offset - n_used) < 0) {
+        E_ERROR("Binary LM file %s is corrupt\n", bin->path);
+        ngram_model_free(base);
+        return NULL;
+    }
+    return base;
+}
+
+static ngram_model_t *
+read_bin(cmd_ln_t * config, const char *path, logmath_t * lmath,
+         ngram_model_t * other)
 {
     int32 is_pipe;
     FILE *fp;
@@ -351,6 +541,14 @@ ngram_model_trie_read_bin(cmd_ln_t * config,
     ngram_model_trie_t *model;
     ngram_model_t *base;
 
+    if (other && other->funcs == &ngram_model_trie_funcs
+        && ((ngram_model_trie_t *) other)->bin
+        && 0 == strcmp(((ngram_model_trie_t *) other)->bin->path, path)) {
+        E_INFO("Sharing mapped LM file %s\n", path);
+        return ngram_model_trie_map_bin(((ngram_model_trie_t *) other)->bin,
+                                        lmath);
+    }
+
     E_INFO("Trying to read LM in trie binary format\n");
     if ((fp = fopen_comp(path, "rb", &is_pipe)) == NULL) {
         E_ERROR("File %s not found\n", path);
@@ -366,6 +564,26 @@ ngram_model_trie_read_bin(cmd_ln_t * config,
         fclose_comp(fp, is_pipe);
         return NULL;
     }
+
+    /* Compressed files can't be mapped.  If mapping fails, read the file. */
+    if (!is_pipe && config && cmd_ln_exists_r(config, "-mmap")
+        && cmd_ln_boolean_r(config, "-mmap")) {
+        ngram_trie_bin_t *bin;
+        long size;
+
+        fseek(fp, 0, SEEK_END);
+        size = ftell(fp);
+        if (size >= 0
+            && (bin = ngram_trie_bin_map(path, (size_t) size)) != NULL) {
+            fclose(fp);
+            E_INFO("Mapped LM file %s into memory\n", path);
+            base = ngram_model_trie_map_bin(bin, lmath);
+            ngram_trie_bin_free(bin);
+            return base;
+        }
+        fseek(fp, (long) hdr_size, SEEK_SET);
+    }
+
     model = (ngram_model_trie_t *) ckd_calloc(1, sizeof(*model));
     base = &model->base;
     fread(&order, sizeof(order), 1, fp);
@@ -378,13 +596,44 @@ ngram_model_trie_read_bin(cmd_ln_t * config,
         base->n_counts[i] = counts[i];
     }
 
-    model->trie = lm_trie_read_bin(counts, order, fp);
+    if ((model->trie = lm_trie_read_bin(counts, order, fp)) == NULL) {
+        ngram_model_free(base);
+        fclose_comp(fp, is_pipe);
+        return NULL;
+    }
     read_word_str(base, fp);
     fclose_comp(fp, is_pipe);
 
     return base;
 }
 
+ngram_model_t *
+ngram_model_trie_read_bin(cmd_ln_t * config,
+                          const char *path, logmath_t * lmath)
+{
+    return read_bin(config, path, lmath, NULL);
+}
+
+ngram_model_t *
+ngram_model_trie_read_bin_shared(cmd_ln_t * config, const char *path,
+                                 logmath_t * lmath, ngram_model_t * other)
+{
+    ngram_model_t *base;
+
+    if ((base = read_bin(config, path, lmath, other)) != NULL)
+        apply_config_weights(base, config);
+    return base;
+}
+
+int
+ngram_model_trie_same_bin(ngram_model_t * a, ngram_model_t * b)
+{
+    return a->funcs == &ngram_model_trie_funcs
+        && b->funcs == &ngram_model_trie_funcs
+        && ((ngram_model_trie_t *) a)->bin != NULL
+        && ((ngram_model_trie_t *) a)->bin == ((ngram_model_trie_t *) b)->bin;
+}
+
 static void
 write_word_str(FILE * fp, ngram_model_t * model)
 {
@@ -592,7 +841,9 @@ static void
 ngram_model_trie_free(ngram_model_t * base)
 {
     ngram_model_trie_t *model = (ngram_model_trie_t *) base;
-    lm_trie_free(model->trie);
+    if (model->trie)
+        lm_trie_free(model->trie);
+    ngram_trie_bin_free(model->bin);
 }
 
 static int
@@ -43,9 +43,15 @@
 #include "ngram_model_internal.h"
 #include "lm_trie.h"
 
+/**
+ * Binary model file mapped read-only into memory.  Shared between models.
+ */
+typedef struct ngram_trie_bin_s ngram_trie_bin_t;
+
 typedef struct ngram_model_trie_s {
     ngram_model_t base;  /**< Base ngram_model_t structure */
     lm_trie_t *trie;     /**< Trie structure that stores ngram relations and weights */
+    ngram_trie_bin_t *bin; /**< Mapped file the trie points into, or NULL if it was read */
 } ngram_model_trie_t;
 
 /**
@@ -55,6 +61,38 @@ ngram_model_t *ngram_model_trie_read_arpa(cmd_ln_t * config,
                                           const char *path,
                                           logmath_t * lmath);
 
+/**
+ * Build N-Gram model from n-grams in memory and arrange it in trie structure.
+ *
+ * Word i of the model is word_str[i], with log10 probability ug_prob[i]
+ * and log10 backoff weight ug_bo[i].  raw_ngrams[n - 2] holds counts[n - 1]
+ * n-grams with log10 weights and their words last word first, like the
+ * ARPA reader produces them.  They are converted and sorted in place and
+ * still belong to the caller afterwards.  Weights from config (-lw, -wip)
+ * are applied as by ngram_model_read().
+ */
+ngram_model_t *ngram_model_trie_build(cmd_ln_t * config,
+                                      logmath_t * lmath, int order,
+                                      uint32 * counts,
+                                      char const *const *word_str,
+                                      float32 const *ug_prob,
+                                      float32 const *ug_bo,
+                                      ngram_raw_t ** raw_ngrams);
+
+/**
+ * Same as ngram_model_trie_build(), but quantizes the weights of higher-order
+ * n-grams to the given number of bits instead of 16, which makes the trie
+ * smaller.  The number of bits is stored in binary files.
+ */
+ngram_model_t *ngram_model_trie_build_quant(cmd_ln_t * config,
+                                            logmath_t * lmath, int order,
+                                            uint32 * counts,
+                                            char const *const *word_str,
+                                            float32 const *ug_prob,
+                                            float32 const *ug_bo,
+                                            ngram_raw_t ** raw_ngrams,
+                                            int quant_bits);
+
 /**
  * Write N-Gram model stored in trie structure in ARPABO format
  */
@@ -67,6 +105,29 @@ ngram_model_t *ngram_model_trie_read_bin(cmd_ln_t * config,
                                          const char *path,
                                          logmath_t * lmath);
 
+/**
+ * Read N-Gram model from the binary file, sharing the mapped file of
+ * another model if both use the same file.
+ *
+ * If -mmap is enabled in config, the trie and word strings point straight
+ * into the memory-mapped file instead of being copied, and other models
+ * read from the same file can share the mapping.  Every model keeps its own
+ * lookup caches and weights, so models sharing a mapping may be used from
+ * different threads, but must be read and freed one at a time.  Words
+ * can't be added to mapped models.  Weights from config (-lw, -wip) are
+ * applied as by ngram_model_read().
+ */
+ngram_model_t *ngram_model_trie_read_bin_shared(cmd_ln_t * config,
+                                                const char *path,
+                                                logmath_t * lmath,
+                                                ngram_model_t * other);
+
+/**
+ * Check whether two models were mapped from the same binary file, and
+ * therefore have the same vocabulary.
+ */
+int ngram_model_trie_same_bin(ngram_model_t * a, ngram_model_t * b);
+
 /**
  * Write trie to binary file
  */
@@ -124,6 +124,19 @@
 #define UPPER_MASK 0x80000000UL /* most significant w-r bits */
 #define LOWER_MASK 0x7fffffffUL /* least significant r bits */
 
+#include "sphinxbase/ckd_alloc.h"
+
+struct genrand_s {
+    unsigned long mt[N];        /* the array for the state vector  */
+    int mti;                    /* mti==N+1 means mt[N] is not initialized */
+};
+
+/* State of the process-wide generator. */
+static genrand_t global_state = { { 0 }, N + 1 };
+
+static void init_genrand_r(genrand_t *rng, unsigned long s);
+static unsigned long genrand_int32_r(genrand_t *rng);
+
 void init_genrand(unsigned long s);
 
 void
@@ -132,14 +145,53 @@ genrand_seed(unsigned long s)
     init_genrand(s);
 }
 
+void
+init_genrand(unsigned long s)
+{
+    init_genrand_r(&global_state, s);
+}
 
-static unsigned long mt[N];     /* the array for the state vector  */
-static int mti = N + 1;         /* mti==N+1 means mt[N] is not initialized */
+unsigned long
+genrand_int32(void)
+{
+    return genrand_int32_r(&global_state);
+}
+
+genrand_t *
+genrand_init(unsigned long s)
+{
+    genrand_t *rng;
+
+    rng = ckd_calloc(1, sizeof(*rng));
+    init_genrand_r(rng, s);
+    return rng;
+}
 
-/* initializes mt[N] with a seed */
 void
-init_genrand(unsigned long s)
+genrand_seed_r(genrand_t *rng, unsigned long s)
+{
+    init_genrand_r(rng, s);
+}
+
+long
+genrand_int31_r(genrand_t *rng)
+{
+    return (long) (genrand_int32_r(rng) >> 1);
+}
+
+void
+genrand_free(genrand_t *rng)
+{
+    ckd_free(rng);
+}
+
+/* initializes mt[N] with a seed */
+static void
+init_genrand_r(genrand_t *rng, unsigned long s)
 {
+    unsigned long *mt = rng->mt;
+    int mti;
+
     mt[0] = s & 0xffffffffUL;
     for (mti = 1; mti < N; mti++) {
         mt[mti] =
@@ -151,21 +203,23 @@ init_genrand(unsigned long s)
         mt[mti] &= 0xffffffffUL;
         /* for >32 bit machines */
     }
+    rng->mti = mti;
 }
 
 /* generates a random number on [0,0xffffffff]-interval */
-unsigned long
-genrand_int32(void)
+static unsigned long
+genrand_int32_r(genrand_t *rng)
 {
+    unsigned long *mt = rng->mt;
     unsigned long y;
-    static unsigned long mag01[2] = { 0x0UL, MATRIX_A };
+    static const unsigned long mag01[2] = { 0x0UL, MATRIX_A };
     /* mag01[x] = x * MATRIX_A  for x=0,1 */
 
-    if (mti >= N) {             /* generate N words at one time */
+    if (rng->mti >= N) {        /* generate N words at one time */
         int kk;
 
-        if (mti == N + 1)       /* if init_genrand() has not been called, */
-            init_genrand(5489UL);       /* a default initial seed is used */
+        if (rng->mti == N + 1)  /* if init_genrand() has not been called, */
+            init_genrand_r(rng, 5489UL);        /* a default initial seed is used */
 
         for (kk = 0; kk < N - M; kk++) {
             y = (mt[kk] & UPPER_MASK) | (mt[kk + 1] & LOWER_MASK);
@@ -178,10 +232,10 @@ genrand_int32(void)
         y = (mt[N - 1] & UPPER_MASK) | (mt[0] & LOWER_MASK);
         mt[N - 1] = mt[M - 1] ^ (y >> 1) ^ mag01[y & 0x1UL];
 
-        mti = 0;
+        rng->mti = 0;
     }
 
-    y = mt[mti++];
+    y = mt[rng->mti++];
 
     /* Tempering */
     y ^= (y >> 11);
@@ -170,6 +170,36 @@ double genrand_real3(void);
 SPHINXBASE_EXPORT
 double genrand_res53(void);
 
+/**
+ * Random generator with its own state, for use by one thread at a time
+ * without affecting the process-wide generator above.
+ */
+typedef struct genrand_s genrand_t;
+
+/**
+ *Create a random generator with its own state, seeded with s.
+ */
+SPHINXBASE_EXPORT
+genrand_t *genrand_init(unsigned long s);
+
+/**
+ *Seed a random generator again, restarting its sequence.
+ */
+SPHINXBASE_EXPORT
+void genrand_seed_r(genrand_t *rng, unsigned long s);
+
+/**
+ *generates a random number on [0,0x7fffffff]-interval 
+ */
+SPHINXBASE_EXPORT
+long genrand_int31_r(genrand_t *rng);
+
+/**
+ *Free a random generator.
+ */
+SPHINXBASE_EXPORT
+void genrand_free(genrand_t *rng);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,230 @@
+#include "mouthCues.h"
+#include <array>
+#include <algorithm>
+#include <cmath>
+
+using std::string;
+using std::vector;
+using std::array;
+
+ShapeSet getPhoneShapeSet(const Phone& phone, centiseconds duration, centiseconds previousDuration) {
+	static const ShapeSet any { Shape::A, Shape::B, Shape::C, Shape::D, Shape::E, Shape::F, Shape::G, Shape::H, Shape::X };
+	static const ShapeSet anyOpen { Shape::B, Shape::C, Shape::D, Shape::E, Shape::F, Shape::G, Shape::H };
+
+	switch (phone) {
+		case Phone::AO: return { Shape::E };
+		case Phone::AA: return { Shape::D };
+		case Phone::IY: return { Shape::B };
+		case Phone::UW: return { Shape::F };
+		case Phone::EH: return { Shape::C };
+		case Phone::IH: return { Shape::B };
+		case Phone::UH: return { Shape::F };
+		case Phone::AH: return duration < 20_cs ? ShapeSet{ Shape::C } : ShapeSet{ Shape::D };
+		case Phone::Schwa: return { Shape::B, Shape::C };
+		case Phone::AE: return { Shape::C };
+		case Phone::EY: return duration < 20_cs ? ShapeSet{ Shape::C, Shape::B } : ShapeSet{ Shape::D, Shape::B };
+		case Phone::AY: return duration < 20_cs ? ShapeSet{ Shape::C, Shape::B } : ShapeSet{ Shape::D, Shape::B };
+		case Phone::OW: return { Shape::E, Shape::F };
+		case Phone::AW: return duration < 30_cs ? ShapeSet{ Shape::C, Shape::E } : ShapeSet{ Shape::D, Shape::E };
+		case Phone::OY: return { Shape::E, Shape::B };
+		case Phone::ER: return duration < 7_cs ? ShapeSet{ Shape::B, Shape::C } : ShapeSet{ Shape::E };
+
+		// Plosives
+		case Phone::P:
+		case Phone::B: return any;  // Note: Plosive timing handled separately
+		case Phone::T:
+		case Phone::D: return anyOpen;  // Note: Plosive timing handled separately
+		case Phone::K:
+		case Phone::G: return { Shape::B, Shape::C, Shape::E, Shape::F, Shape::H };
+
+		// Affricates
+		case Phone::CH:
+		case Phone::JH: return { Shape::B, Shape::F };
+
+		// Fricatives
+		case Phone::F:
+		case Phone::V: return { Shape::G };
+		case Phone::TH:
+		case Phone::DH:
+		case Phone::S:
+		case Phone::Z:
+		case Phone::SH:
+		case Phone::ZH: return { Shape::B, Shape::F };
+		case Phone::HH: return any;  // think "m-hm"
+
+		// Nasals
+		case Phone::M: return { Shape::A };
+		case Phone::N: return { Shape::B, Shape::C, Shape::F, Shape::H };
+		case Phone::NG: return { Shape::B, Shape::C, Shape::E, Shape::F };
+
+		// Liquids and Glides
+		case Phone::L: return duration < 20_cs
+			? ShapeSet{ Shape::B, Shape::E, Shape::F, Shape::H }
+			: ShapeSet{ Shape::H };
+		case Phone::R: return { Shape::B, Shape::E, Shape::F };
+		case Phone::Y: return { Shape::B, Shape::C, Shape::F };
+		case Phone::W: return { Shape::F };
+
+		// Non-speech sounds
+		case Phone::Breath:
+		case Phone::Cough:
+		case Phone::Smack: return { Shape::C };
+		case Phone::Noise: return { Shape::B };
+
+		default: return { Shape::X };
+	}
+}
+
+Shape getClosestShape(Shape reference, const ShapeSet& shapes) {
+	if (shapes.empty()) {
+		return Shape::X;
+	}
+
+	static const array<array<Shape, 9>, 9> effortMatrix = {{
+		/* A */ {{ Shape::A, Shape::X, Shape::G, Shape::B, Shape::C, Shape::H, Shape::E, Shape::D, Shape::F }},
+		/* B */ {{ Shape::B, Shape::G, Shape::A, Shape::X, Shape::C, Shape::H, Shape::E, Shape::D, Shape::F }},
+		/* C */ {{ Shape::C, Shape::H, Shape::B, Shape::G, Shape::D, Shape::A, Shape::X, Shape::E, Shape::F }},
+		/* D */ {{ Shape::D, Shape::C, Shape::H, Shape::B, Shape::G, Shape::A, Shape::X, Shape::E, Shape::F }},
+		/* E */ {{ Shape::E, Shape::C, Shape::H, Shape::B, Shape::G, Shape::A, Shape::X, Shape::D, Shape::F }},
+		/* F */ {{ Shape::F, Shape::B, Shape::G, Shape::A, Shape::X, Shape::C, Shape::H, Shape::E, Shape::D }},
+		/* G */ {{ Shape::G, Shape::A, Shape::B, Shape::C, Shape::H, Shape::X, Shape::E, Shape::D, Shape::F }},
+		/* H */ {{ Shape::H, Shape::C, Shape::B, Shape::G, Shape::D, Shape::A, Shape::X, Shape::E, Shape::F }},
+		/* X */ {{ Shape::X, Shape::A, Shape::G, Shape::B, Shape::C, Shape::H, Shape::E, Shape::D, Shape::F }}
+	}};
+
+	const auto& closestShapes = effortMatrix[static_cast<size_t>(reference)];
+	for (Shape closestShape : closestShapes) {
+		if (shapes.find(closestShape) != shapes.end()) {
+			return closestShape;
+		}
+	}
+
+	return *shapes.begin();  // Fallback to first available shape
+}
+
+const string& shapeToString(Shape shape) {
+	static const array<string, static_cast<size_t>(Shape::EndSentinel)> names = [] {
+		array<string, static_cast<size_t>(Shape::EndSentinel)> names;
+		for (size_t i = 0; i < names.size(); ++i) {
+			names[i] = ShapeConverter::get().toString(static_cast<Shape>(i));
+		}
+		return names;
+	}();
+	return names[static_cast<size_t>(shape)];
+}
+
+MouthCue createMouthCue(double start, double end, Shape shape) {
+	return { start, end, shapeToString(shape), static_cast<uint8_t>(shape) };
+}
+
+vector<MouthCue> MouthCueGenerator::addPhones(const Timeline<Phone>& phones) {
+	vector<MouthCue> mouthCues;
+
+	// Add initial X shape if there's a gap at the start
+	if (!hasPhones && phones.begin() != phones.end() && phones.begin()->getTimeRange().getStart() > 0_cs) {
+		mouthCues.push_back(createMouthCue(
+			0.0,
+			phones.begin()->getTimeRange().getStart().count() / 100.0,
+			Shape::X
+		));
+	}
+
+	// Process each phone
+	for (auto it = phones.begin(); it != phones.end(); ++it) {
+		const Phone& phone = it->getValue();
+		const TimeRange& timeRange = it->getTimeRange();
+		const centiseconds duration = timeRange.getDuration();
+		const centiseconds previousDuration = hasPhones ? lastTimeRange.getDuration() : 0_cs;
+
+		// Add X shape for gaps between phones (silence)
+		if (!lastTimeRange.empty() && timeRange.getStart() > lastTimeRange.getEnd()) {
+			const double gapStart = lastTimeRange.getEnd().count() / 100.0;
+			const double gapEnd = timeRange.getStart().count() / 100.0;
+			if (gapEnd - gapStart >= 0.1) { // Only add X for gaps >= 100ms
+				mouthCues.push_back(createMouthCue(
+					gapStart,
+					gapEnd,
+					Shape::X
+				));
+			}
+		}
+
+		// Get the set of possible shapes for this phone
+		ShapeSet shapeSet = getPhoneShapeSet(phone, duration, previousDuration);
+
+		// Choose the best shape based on the current shape
+		Shape nextShape = getClosestShape(currentShape, shapeSet);
+
+		// Special handling for plosives
+		if (phone == Phone::P || phone == Phone::B || phone == Phone::T || phone == Phone::D) {
+			const centiseconds occlusionDuration = std::min(std::max(previousDuration / 2, 4_cs), 12_cs);
+			const centiseconds occlusionStart = timeRange.getStart() - occlusionDuration;
+
+			// Add pre-occlusion shape
+			if (phone == Phone::P || phone == Phone::B) {
+				mouthCues.push_back(createMouthCue(
+					occlusionStart.count() / 100.0,
+					timeRange.getStart().count() / 100.0,
+					Shape::A
+				));
+			} else {
+				mouthCues.push_back(createMouthCue(
+					occlusionStart.count() / 100.0,
+					timeRange.getStart().count() / 100.0,
+					Shape::B
+				));
+			}
+		}
+
+		// Add the main shape
+		mouthCues.push_back(createMouthCue(
+			timeRange.getStart().count() / 100.0,
+			timeRange.getEnd().count() / 100.0,
+			nextShape
+		));
+
+		currentShape = nextShape;
+		lastTimeRange = timeRange;
+		hasPhones = true;
+	}
+
+	return mouthCues;
+}
+
+vector<MouthCue> MouthCueGenerator::finish(double audioDurationSeconds) {
+	vector<MouthCue> mouthCues;
+
+	// Add final X shape if there's silence at the end
+	if (hasPhones && lastTimeRange.getEnd().count() / 100.0 < audioDurationSeconds) {
+		mouthCues.push_back(createMouthCue(
+			lastTimeRange.getEnd().count() / 100.0,
+			audioDurationSeconds,
+			Shape::X
+		));
+	}
+
+	return mouthCues;
+}
+
+vector<MouthCue> consolidateMouthCues(const vector<MouthCue>& mouthCues) {
+	vector<MouthCue> consolidatedCues;
+	for (size_t i = 0; i < mouthCues.size(); ++i) {
+		if (consolidatedCues.empty() ||
+			consolidatedCues.back().shape != mouthCues[i].shape ||
+			std::abs(consolidatedCues.back().end - mouthCues[i].start) > 0.001) {
+			consolidatedCues.push_back(mouthCues[i]);
+		} else {
+			consolidatedCues.back().end = mouthCues[i].end;
+		}
+	}
+
+	return consolidatedCues;
+}
+
+vector<MouthCue> processPhones(const BoundedTimeline<Phone>& phones, double audioDurationSeconds) {
+	MouthCueGenerator generator;
+	vector<MouthCue> mouthCues = generator.addPhones(phones);
+	const vector<MouthCue> finalMouthCues = generator.finish(audioDurationSeconds);
+	mouthCues.insert(mouthCues.end(), finalMouthCues.begin(), finalMouthCues.end());
+	return consolidateMouthCues(mouthCues);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "core/Phone.h"
+#include "core/Shape.h"
+#include "time/BoundedTimeline.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+
+struct MouthCue {
+	double start;	// Start time in seconds
+	double end;	// End time in seconds
+	std::string value;
+	uint8_t shape;	// Ordinal of the Shape enum
+};
+
+// Returns the name of a shape without going through a string stream
+const std::string& shapeToString(Shape shape);
+
+MouthCue createMouthCue(double start, double end, Shape shape);
+
+// Returns the shapes that can be used to represent a phone with the specified timing
+ShapeSet getPhoneShapeSet(const Phone& phone, centiseconds duration, centiseconds previousDuration);
+
+// Returns the shape of the set that is easiest to reach from the reference shape
+Shape getClosestShape(Shape reference, const ShapeSet& shapes);
+
+// Generates mouth cues from phones.
+// Phones can be added in batches (e.g. one utterance at a time), as long as each batch starts
+// after the previous one. The animation state carries over between batches.
+class MouthCueGenerator {
+public:
+	// Returns the mouth cues for the specified phones
+	std::vector<MouthCue> addPhones(const Timeline<Phone>& phones);
+
+	// Returns the final mouth cues up to the end of the audio
+	std::vector<MouthCue> finish(double audioDurationSeconds);
+
+private:
+	Shape currentShape = Shape::X;
+	TimeRange lastTimeRange;
+	bool hasPhones = false;
+};
+
+// Merges consecutive mouth cues with the same shape
+std::vector<MouthCue> consolidateMouthCues(const std::vector<MouthCue>& mouthCues);
+
+// Generates the mouth cues for all phones of a recording
+std::vector<MouthCue> processPhones(const BoundedTimeline<Phone>& phones, double audioDurationSeconds);
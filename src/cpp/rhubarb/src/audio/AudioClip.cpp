@@ -1,4 +1,7 @@
 #include "AudioClip.h"
+#include "sampleConversion.h"
+#include <algorithm>
+#include <cstring>
 #include <format.h>
 
 using std::invalid_argument;
@@ -47,6 +50,54 @@ SampleReader AudioClip::createSampleReader() const {
 	return SafeSampleReader(createUnsafeSampleReader(), size());
 }
 
+static void checkBlock(AudioClip::size_type start, AudioClip::size_type count, AudioClip::size_type size) {
+	if (start < 0 || count < 0 || start + count > size) {
+		throw invalid_argument(fmt::format(
+			"Cannot read {} samples from sample index {}. Clip size is {}.",
+			count,
+			start,
+			size
+		));
+	}
+}
+
+void AudioClip::readBlock(size_type start, size_type count, value_type* out) const {
+	checkBlock(start, count, size());
+	if (count == 0) return;
+
+	readUnsafeBlock(start, count, out);
+}
+
+void AudioClip::readBlock(size_type start, size_type count, int16_t* out) const {
+	checkBlock(start, count, size());
+	if (count == 0) return;
+
+	if (const int16_t* samples = getInt16Samples()) {
+		std::memcpy(out, samples + start, static_cast<size_t>(count) * sizeof(int16_t));
+		return;
+	}
+
+	// Convert blocks of float samples, small enough for the stack of any thread
+	const size_type blockSize = 1024;
+	value_type block[blockSize];
+	for (size_type blockStart = 0; blockStart < count; blockStart += blockSize) {
+		const size_type blockCount = std::min(blockSize, count - blockStart);
+		readUnsafeBlock(start + blockStart, blockCount, block);
+		convertFloatToInt16(block, static_cast<size_t>(blockCount), out + blockStart);
+	}
+}
+
+const int16_t* AudioClip::getInt16Samples() const {
+	return nullptr;
+}
+
+void AudioClip::readUnsafeBlock(size_type start, size_type count, value_type* out) const {
+	const SampleReader read = createUnsafeSampleReader();
+	for (size_type i = 0; i < count; ++i) {
+		out[i] = read(start + i);
+	}
+}
+
 AudioClip::iterator AudioClip::begin() const {
 	return SampleIterator(*this, 0);
 }
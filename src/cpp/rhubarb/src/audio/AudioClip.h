@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <cstdint>
 #include "time/TimeRange.h"
 #include <functional>
 #include "tools/Lazy.h"
@@ -22,10 +23,21 @@ public:
 	virtual size_type size() const = 0;
 	TimeRange getTruncatedRange() const;
 	SampleReader createSampleReader() const;
+	// Reads count samples, starting at sample index start. Much faster than reading the samples
+	// one at a time.
+	void readBlock(size_type start, size_type count, value_type* out) const;
+	// Reads count samples as 16-bit integers. Clips that store 16-bit samples don't convert them.
+	void readBlock(size_type start, size_type count, int16_t* out) const;
+	// Returns the samples if the clip stores them in memory as 16-bit integers, so that they can be
+	// used in place. Otherwise, returns nullptr.
+	virtual const int16_t* getInt16Samples() const;
 	iterator begin() const;
 	iterator end() const;
 private:
 	virtual SampleReader createUnsafeSampleReader() const = 0;
+	// Reads a block that is known to lie within the clip.
+	// The default implementation reads one sample at a time.
+	virtual void readUnsafeBlock(size_type start, size_type count, value_type* out) const;
 };
 
 using AudioEffect = std::function<std::unique_ptr<AudioClip>(std::unique_ptr<AudioClip>)>;
@@ -23,6 +23,15 @@ SampleReader AudioSegment::createUnsafeSampleReader() const {
 	};
 }
 
+void AudioSegment::readUnsafeBlock(size_type start, size_type count, value_type* out) const {
+	inputClip->readBlock(start + sampleOffset, count, out);
+}
+
+const int16_t* AudioSegment::getInt16Samples() const {
+	const int16_t* samples = inputClip->getInt16Samples();
+	return samples ? samples + sampleOffset : nullptr;
+}
+
 AudioEffect segment(const TimeRange& range) {
 	return [range](unique_ptr<AudioClip> inputClip) {
 		return make_unique<AudioSegment>(std::move(inputClip), range);
@@ -3,15 +3,24 @@
 #include "AudioClip.h"
 #include <vector>
 #include <memory>
+#include <algorithm>
 
+// Audio clip that owns its samples. The samples are immutable and shared by all clones, so cloning
+// doesn't copy them.
 class BufferAudioClip : public AudioClip {
 public:
     BufferAudioClip(const float* data, size_t size, int sampleRate) :
-        buffer(data, data + size),
+        BufferAudioClip(std::vector<float>(data, data + size), sampleRate) {}
+
+    BufferAudioClip(std::vector<float> samples, int sampleRate) :
+        BufferAudioClip(std::make_shared<const std::vector<float>>(std::move(samples)), sampleRate) {}
+
+    BufferAudioClip(std::shared_ptr<const std::vector<float>> samples, int sampleRate) :
+        buffer(std::move(samples)),
         sampleRate_(sampleRate) {}
 
     std::unique_ptr<AudioClip> clone() const override {
-        return std::make_unique<BufferAudioClip>(buffer.data(), buffer.size(), sampleRate_);
+        return std::make_unique<BufferAudioClip>(*this);
     }
 
     int getSampleRate() const override {
@@ -19,16 +28,20 @@ public:
     }
 
     size_type size() const override {
-        return buffer.size();
+        return buffer->size();
     }
 
 private:
     SampleReader createUnsafeSampleReader() const override {
-        return [data = buffer.data()](size_type pos) -> float {
-            return data[pos];
+        return [buffer = buffer](size_type pos) -> float {
+            return (*buffer)[pos];
         };
     }
 
-    std::vector<float> buffer;
+    void readUnsafeBlock(size_type start, size_type count, value_type* out) const override {
+        std::copy(buffer->begin() + start, buffer->begin() + start + count, out);
+    }
+
+    std::shared_ptr<const std::vector<float>> buffer;
     int sampleRate_;
-}; 
\ No newline at end of file
+};
@@ -1,8 +1,11 @@
 #include "DcOffset.h"
 #include <cmath>
+#include <algorithm>
+#include <vector>
 
 using std::unique_ptr;
 using std::make_unique;
+using std::vector;
 
 DcOffset::DcOffset(unique_ptr<AudioClip> inputClip, float offset) :
 	inputClip(std::move(inputClip)),
@@ -25,12 +28,19 @@ SampleReader DcOffset::createUnsafeSampleReader() const {
 	};
 }
 
+void DcOffset::readUnsafeBlock(size_type start, size_type count, value_type* out) const {
+	inputClip->readBlock(start, count, out);
+	for (size_type i = 0; i < count; ++i) {
+		out[i] = out[i] * factor + offset;
+	}
+}
+
 float getDcOffset(const AudioClip& audioClip) {
 	int flatMeanSampleCount, fadingMeanSampleCount;
 	const int sampleRate = audioClip.getSampleRate();
-	if (audioClip.size() > 4 * sampleRate) {
+	if (audioClip.size() > dcOffsetWindowSeconds * sampleRate) {
 		// Long audio file. Average over the first 3 seconds, then fade out over the 4th.
-		flatMeanSampleCount = 3 * sampleRate;
+		flatMeanSampleCount = (dcOffsetWindowSeconds - 1) * sampleRate;
 		fadingMeanSampleCount = 1 * sampleRate;
 	} else {
 		// Short audio file. Average over the entire duration.
@@ -38,15 +48,24 @@ float getDcOffset(const AudioClip& audioClip) {
 		fadingMeanSampleCount = 0;
 	}
 
-	const auto read = audioClip.createSampleReader();
+	const int sampleCount = flatMeanSampleCount + fadingMeanSampleCount;
+	const int blockSize = 4096;
+	vector<float> block(std::min(sampleCount, blockSize));
 	double sum = 0;
-	for (int i = 0; i < flatMeanSampleCount; ++i) {
-		sum += read(i);
-	}
-	for (int i = 0; i < fadingMeanSampleCount; ++i) {
-		const double weight =
-			static_cast<double>(fadingMeanSampleCount - i) / fadingMeanSampleCount;
-		sum += read(flatMeanSampleCount + i) * weight;
+	for (int blockStart = 0; blockStart < sampleCount; blockStart += blockSize) {
+		const int blockEnd = std::min(blockStart + blockSize, sampleCount);
+		audioClip.readBlock(blockStart, blockEnd - blockStart, block.data());
+
+		int i = blockStart;
+		for (; i < std::min(blockEnd, flatMeanSampleCount); ++i) {
+			sum += block[i - blockStart];
+		}
+		for (; i < blockEnd; ++i) {
+			const int fadingIndex = i - flatMeanSampleCount;
+			const double weight =
+				static_cast<double>(fadingMeanSampleCount - fadingIndex) / fadingMeanSampleCount;
+			sum += block[i - blockStart] * weight;
+		}
 	}
 
 	const double totalWeight = flatMeanSampleCount + (fadingMeanSampleCount + 1) / 2.0;
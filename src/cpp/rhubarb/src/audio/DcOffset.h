@@ -12,6 +12,7 @@ public:
 	size_type size() const override;
 private:
 	SampleReader createUnsafeSampleReader() const override;
+	void readUnsafeBlock(size_type start, size_type count, value_type* out) const override;
 
 	std::shared_ptr<AudioClip> inputClip;
 	float offset;
@@ -26,6 +27,10 @@ inline AudioClip::size_type DcOffset::size() const {
 	return inputClip->size();
 }
 
+// Audio longer than this many seconds gets the DC offset of its beginning.
+// Appending audio to it doesn't change its offset.
+constexpr int dcOffsetWindowSeconds = 4;
+
 float getDcOffset(const AudioClip& audioClip);
 
 AudioEffect addDcOffset(float offset, float epsilon = 1.0f / 15000);
@@ -0,0 +1,98 @@
+#include "HalfBandDecimator.h"
+#include "SampleRateConverter.h"
+#include <stdexcept>
+#include <format.h>
+#include <algorithm>
+#include <array>
+#include <vector>
+
+using std::invalid_argument;
+using std::unique_ptr;
+using std::make_unique;
+using std::vector;
+
+// Number of nonzero taps on either side of the center tap. Together with the Kaiser window, this
+// attenuates the stopband by about 70dB.
+constexpr int sideTapCount = 12;
+constexpr double kaiserBeta = 7.0;
+
+// Returns the taps at odd distances 1, 3, 5, ... from the center. The center tap is 0.5.
+static const std::array<float, sideTapCount>& getSideTaps() {
+	static const std::array<float, sideTapCount> sideTaps = [] {
+		const double halfWidth = 2 * sideTapCount;
+		std::array<double, sideTapCount> taps;
+		double sum = 0;
+		for (int i = 0; i < sideTapCount; ++i) {
+			const int distance = 2 * i + 1;
+			taps[i] = windowedSinc(distance, 0.5, halfWidth, kaiserBeta);
+			sum += 2 * taps[i];
+		}
+
+		// Normalize to unity gain: the side taps add up to the same as the center tap
+		std::array<float, sideTapCount> result;
+		for (int i = 0; i < sideTapCount; ++i) {
+			result[i] = static_cast<float>(taps[i] * 0.5 / sum);
+		}
+		return result;
+	}();
+	return sideTaps;
+}
+
+static void decimateBlock(const AudioClip& inputClip, int64_t start, int64_t count, float* out) {
+	// Read all input samples that contribute to the block at once.
+	// Samples beyond either end of the input clip are silent.
+	const int halfLength = 2 * sideTapCount - 1;
+	const int64_t inputStart = 2 * start - halfLength;
+	const int64_t inputEnd = 2 * (start + count - 1) + halfLength + 1;
+	vector<float> input(static_cast<size_t>(inputEnd - inputStart), 0.0f);
+	const int64_t readStart = std::max<int64_t>(inputStart, 0);
+	const int64_t readEnd = std::min<int64_t>(inputEnd, inputClip.size());
+	if (readStart < readEnd) {
+		inputClip.readBlock(readStart, readEnd - readStart, &input[readStart - inputStart]);
+	}
+
+	// The filter is symmetric, so each tap applies to a pair of samples
+	const std::array<float, sideTapCount>& sideTaps = getSideTaps();
+	for (int64_t i = 0; i < count; ++i) {
+		const float* center = &input[2 * i + halfLength];
+		float sum = 0.5f * center[0];
+		for (int tap = 0; tap < sideTapCount; ++tap) {
+			const int distance = 2 * tap + 1;
+			sum += sideTaps[tap] * (center[-distance] + center[distance]);
+		}
+		out[i] = sum;
+	}
+}
+
+HalfBandDecimator::HalfBandDecimator(unique_ptr<AudioClip> inputClip) :
+	inputClip(std::move(inputClip))
+{
+	if (this->inputClip->getSampleRate() % 2 != 0) {
+		throw invalid_argument(fmt::format(
+			"Cannot halve odd sample rate {}Hz.",
+			this->inputClip->getSampleRate()
+		));
+	}
+}
+
+unique_ptr<AudioClip> HalfBandDecimator::clone() const {
+	return make_unique<HalfBandDecimator>(*this);
+}
+
+SampleReader HalfBandDecimator::createUnsafeSampleReader() const {
+	return [inputClip = inputClip](size_type index) {
+		float sample;
+		decimateBlock(*inputClip, index, 1, &sample);
+		return sample;
+	};
+}
+
+void HalfBandDecimator::readUnsafeBlock(size_type start, size_type count, value_type* out) const {
+	decimateBlock(*inputClip, start, count, out);
+}
+
+AudioEffect decimateByTwo() {
+	return [](unique_ptr<AudioClip> inputClip) {
+		return make_unique<HalfBandDecimator>(std::move(inputClip));
+	};
+}
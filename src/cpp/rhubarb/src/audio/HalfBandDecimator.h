@@ -0,0 +1,29 @@
+#pragma once
+
+#include "AudioClip.h"
+
+// Halves the sample rate of an audio clip using a half-band lowpass filter.
+// Every other tap of a half-band filter is zero, so this takes about half the work of a general
+// resampler.
+class HalfBandDecimator : public AudioClip {
+public:
+	HalfBandDecimator(std::unique_ptr<AudioClip> inputClip);
+	std::unique_ptr<AudioClip> clone() const override;
+	int getSampleRate() const override;
+	size_type size() const override;
+private:
+	SampleReader createUnsafeSampleReader() const override;
+	void readUnsafeBlock(size_type start, size_type count, value_type* out) const override;
+
+	std::shared_ptr<AudioClip> inputClip;
+};
+
+inline int HalfBandDecimator::getSampleRate() const {
+	return inputClip->getSampleRate() / 2;
+}
+
+inline AudioClip::size_type HalfBandDecimator::size() const {
+	return (inputClip->size() + 1) / 2;
+}
+
+AudioEffect decimateByTwo();
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "AudioClip.h"
+#include "sampleConversion.h"
+#include <cstdint>
+#include <vector>
+
+// Audio clip that owns 16-bit samples. The samples are immutable and shared by all clones, so
+// cloning doesn't copy them.
+class Int16AudioClip : public AudioClip {
+public:
+	Int16AudioClip(std::shared_ptr<const std::vector<int16_t>> samples, int sampleRate) :
+		samples(std::move(samples)),
+		sampleRate(sampleRate)
+	{}
+
+	std::unique_ptr<AudioClip> clone() const override {
+		return std::make_unique<Int16AudioClip>(*this);
+	}
+
+	int getSampleRate() const override {
+		return sampleRate;
+	}
+
+	size_type size() const override {
+		return samples->size();
+	}
+
+	const int16_t* getInt16Samples() const override {
+		return samples->data();
+	}
+
+private:
+	SampleReader createUnsafeSampleReader() const override {
+		return [samples = samples](size_type index) {
+			return (*samples)[index] / 32768.0f;
+		};
+	}
+
+	void readUnsafeBlock(size_type start, size_type count, value_type* out) const override {
+		convertInt16ToFloat(samples->data() + start, static_cast<size_t>(count), out);
+	}
+
+	std::shared_ptr<const std::vector<int16_t>> samples;
+	int sampleRate;
+};
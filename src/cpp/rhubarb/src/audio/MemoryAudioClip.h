@@ -0,0 +1,70 @@
+#pragma once
+
+#include "AudioClip.h"
+#include "sampleConversion.h"
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+
+// Audio clip that reads its samples directly from memory it doesn't own, without copying them.
+// The memory must stay valid as long as the clip or any of its clones is alive.
+// If only the end of the clip is in memory, data holds the samples from firstIndex on. Earlier samples
+// must not be read.
+template<typename TSample>
+class MemoryAudioClip : public AudioClip {
+public:
+	MemoryAudioClip(const TSample* data, size_type size, int sampleRate, size_type firstIndex = 0) :
+		data(data),
+		sampleCount(size),
+		sampleRate(sampleRate),
+		firstIndex(firstIndex)
+	{}
+
+	std::unique_ptr<AudioClip> clone() const override {
+		return std::make_unique<MemoryAudioClip>(*this);
+	}
+
+	int getSampleRate() const override {
+		return sampleRate;
+	}
+
+	size_type size() const override {
+		return sampleCount;
+	}
+
+	const int16_t* getInt16Samples() const override {
+		if constexpr (std::is_same<TSample, int16_t>::value) {
+			return firstIndex == 0 ? data : nullptr;
+		} else {
+			return nullptr;
+		}
+	}
+
+private:
+	SampleReader createUnsafeSampleReader() const override {
+		return [data = data, firstIndex = firstIndex](size_type index) {
+			return toFloatSample(data[index - firstIndex]);
+		};
+	}
+
+	void readUnsafeBlock(size_type start, size_type count, value_type* out) const override {
+		if constexpr (std::is_same<TSample, int16_t>::value) {
+			convertInt16ToFloat(data + (start - firstIndex), static_cast<size_t>(count), out);
+		} else {
+			std::copy(data + (start - firstIndex), data + (start - firstIndex + count), out);
+		}
+	}
+
+	static value_type toFloatSample(float sample) {
+		return sample;
+	}
+
+	static value_type toFloatSample(int16_t sample) {
+		return sample / 32768.0f;
+	}
+
+	const TSample* data;
+	size_type sampleCount;
+	int sampleRate;
+	size_type firstIndex;
+};
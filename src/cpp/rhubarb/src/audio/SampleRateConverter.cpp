@@ -2,65 +2,265 @@
 #include "SampleRateConverter.h"
 #include <stdexcept>
 #include <format.h>
+#include <algorithm>
+#include <numeric>
+#include <map>
+#include <mutex>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
 
 using std::invalid_argument;
 using std::unique_ptr;
 using std::make_unique;
+using std::shared_ptr;
+using std::make_shared;
+using std::vector;
+
+using Filter = SampleRateConverter::Filter;
+
+// Filter design. The passband ends slightly below the lower of both Nyquist frequencies, leaving
+// room for the transition band. The Kaiser window attenuates the stopband by about 80dB.
+constexpr int zeroCrossingCount = 16;
+constexpr double rolloff = 0.95;
+constexpr double kaiserBeta = 8.0;
+
+// Rate pairs without a small common multiple would need a huge number of phases. For those,
+// input positions are rounded to the nearest of this many phases.
+constexpr int maxPhaseCount = 512;
+
+constexpr int simdWidth = 8;
+
+static shared_ptr<const Filter> createFilter(int upFactor, int downFactor) {
+	const int phaseCount = std::min(upFactor, maxPhaseCount);
+	// Cutoff frequency relative to the input Nyquist frequency
+	const double cutoff = rolloff * std::min(1.0, static_cast<double>(upFactor) / downFactor);
+	// Half the filter length, in input samples
+	const double halfWidth = zeroCrossingCount / cutoff;
+	const int leadingTapCount = static_cast<int>(std::ceil(halfWidth));
+	const int tapCount = (2 * leadingTapCount + 1 + simdWidth - 1) / simdWidth * simdWidth;
+
+	auto filter = make_shared<Filter>();
+	filter->upFactor = upFactor;
+	filter->downFactor = downFactor;
+	filter->phaseCount = phaseCount;
+	filter->tapCount = tapCount;
+	filter->leadingTapCount = leadingTapCount;
+	filter->taps.assign(static_cast<size_t>(phaseCount) * tapCount, 0.0f);
+
+	for (int phase = 0; phase < phaseCount; ++phase) {
+		// Distance of the output position past the input sample it belongs to
+		const double fraction = static_cast<double>(phase) / phaseCount;
+		vector<double> taps(tapCount, 0.0);
+		double sum = 0;
+		for (int tap = 0; tap < 2 * leadingTapCount + 1; ++tap) {
+			const double distance = tap - leadingTapCount - fraction;
+			taps[tap] = windowedSinc(distance, cutoff, halfWidth, kaiserBeta);
+			sum += taps[tap];
+		}
+
+		// Normalize each phase to unity gain, so that constant signals stay constant
+		float* phaseTaps = &filter->taps[static_cast<size_t>(phase) * tapCount];
+		for (int tap = 0; tap < tapCount; ++tap) {
+			phaseTaps[tap] = static_cast<float>(taps[tap] / sum);
+		}
+	}
+	return filter;
+}
+
+// Filters only depend on the rates, and converters are created for every recognition run
+static shared_ptr<const Filter> getFilter(int upFactor, int downFactor) {
+	static std::mutex mutex;
+	static std::map<std::pair<int, int>, shared_ptr<const Filter>> filters;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	shared_ptr<const Filter>& filter = filters[{ upFactor, downFactor }];
+	if (!filter) {
+		filter = createFilter(upFactor, downFactor);
+	}
+	return filter;
+}
+
+// Returns the sum of products of two arrays whose length is a multiple of simdWidth
+static float dotProduct(const float* a, const float* b, int count) {
+#if defined(__AVX__)
+	__m256 sum = _mm256_setzero_ps();
+	for (int i = 0; i < count; i += 8) {
+#if defined(__FMA__)
+		sum = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum);
+#else
+		sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+#endif
+	}
+	__m128 sum4 = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+	sum4 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+	sum4 = _mm_add_ss(sum4, _mm_shuffle_ps(sum4, sum4, 1));
+	return _mm_cvtss_f32(sum4);
+#elif defined(__SSE__) || defined(_M_X64)
+	__m128 sum0 = _mm_setzero_ps();
+	__m128 sum1 = _mm_setzero_ps();
+	for (int i = 0; i < count; i += 8) {
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+	}
+	__m128 sum = _mm_add_ps(sum0, sum1);
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+	return _mm_cvtss_f32(sum);
+#elif defined(__wasm_simd128__)
+	v128_t sum0 = wasm_f32x4_splat(0.0f);
+	v128_t sum1 = wasm_f32x4_splat(0.0f);
+	for (int i = 0; i < count; i += 8) {
+		sum0 = wasm_f32x4_add(sum0, wasm_f32x4_mul(wasm_v128_load(a + i), wasm_v128_load(b + i)));
+		sum1 = wasm_f32x4_add(
+			sum1,
+			wasm_f32x4_mul(wasm_v128_load(a + i + 4), wasm_v128_load(b + i + 4))
+		);
+	}
+	const v128_t sum = wasm_f32x4_add(sum0, sum1);
+	return wasm_f32x4_extract_lane(sum, 0) + wasm_f32x4_extract_lane(sum, 1)
+		+ wasm_f32x4_extract_lane(sum, 2) + wasm_f32x4_extract_lane(sum, 3);
+#else
+	float sum = 0;
+	for (int i = 0; i < count; ++i) {
+		sum += a[i] * b[i];
+	}
+	return sum;
+#endif
+}
+
+// The input sample at or before an output sample, and the phase of the output sample
+struct InputPosition {
+	int64_t index;
+	int phase;
+};
+
+static InputPosition getInputPosition(const Filter& filter, int64_t outputIndex) {
+	const int64_t numerator = outputIndex * filter.downFactor;
+	InputPosition position { numerator / filter.upFactor, 0 };
+	const int64_t remainder = numerator % filter.upFactor;
+	if (filter.phaseCount == filter.upFactor) {
+		position.phase = static_cast<int>(remainder);
+	} else {
+		position.phase = static_cast<int>(
+			(remainder * filter.phaseCount + filter.upFactor / 2) / filter.upFactor
+		);
+		if (position.phase == filter.phaseCount) {
+			++position.index;
+			position.phase = 0;
+		}
+	}
+	return position;
+}
+
+static void resampleBlock(
+	const AudioClip& inputClip,
+	const Filter& filter,
+	int64_t start,
+	int64_t count,
+	float* out
+) {
+	// Read all input samples that contribute to the block at once.
+	// Samples beyond either end of the input clip are silent.
+	const int64_t inputStart = getInputPosition(filter, start).index - filter.leadingTapCount;
+	const int64_t inputEnd =
+		getInputPosition(filter, start + count - 1).index - filter.leadingTapCount + filter.tapCount;
+	vector<float> input(static_cast<size_t>(inputEnd - inputStart), 0.0f);
+	const int64_t readStart = std::max<int64_t>(inputStart, 0);
+	const int64_t readEnd = std::min<int64_t>(inputEnd, inputClip.size());
+	if (readStart < readEnd) {
+		inputClip.readBlock(readStart, readEnd - readStart, &input[readStart - inputStart]);
+	}
+
+	for (int64_t i = 0; i < count; ++i) {
+		const InputPosition position = getInputPosition(filter, start + i);
+		const float* samples = &input[position.index - filter.leadingTapCount - inputStart];
+		const float* taps = &filter.taps[static_cast<size_t>(position.phase) * filter.tapCount];
+		out[i] = dotProduct(samples, taps, filter.tapCount);
+	}
+}
 
 SampleRateConverter::SampleRateConverter(unique_ptr<AudioClip> inputClip, int outputSampleRate) :
 	inputClip(std::move(inputClip)),
-	downscalingFactor(static_cast<double>(this->inputClip->getSampleRate()) / outputSampleRate),
-	outputSampleRate(outputSampleRate),
-	outputSampleCount(std::lround(this->inputClip->size() / downscalingFactor))
+	outputSampleRate(outputSampleRate)
 {
 	if (outputSampleRate <= 0) {
 		throw invalid_argument("Sample rate must be positive.");
 	}
-	if (this->inputClip->getSampleRate() < outputSampleRate) {
-		throw invalid_argument(fmt::format(
-			"Upsampling not supported. Input sample rate must not be below {}Hz.",
-			outputSampleRate
-		));
+	const int inputSampleRate = this->inputClip->getSampleRate();
+	if (inputSampleRate <= 0) {
+		throw invalid_argument(fmt::format("Unsupported input sample rate {}Hz.", inputSampleRate));
 	}
+
+	const int commonDivisor = std::gcd(inputSampleRate, outputSampleRate);
+	const int upFactor = outputSampleRate / commonDivisor;
+	const int downFactor = inputSampleRate / commonDivisor;
+	// Equal rates don't need a filter
+	if (upFactor != downFactor) {
+		filter = getFilter(upFactor, downFactor);
+	}
+	outputSampleCount = std::lround(
+		static_cast<double>(this->inputClip->size()) * upFactor / downFactor
+	);
 }
 
 unique_ptr<AudioClip> SampleRateConverter::clone() const {
 	return make_unique<SampleRateConverter>(*this);
 }
 
-float mean(double inputStart, double inputEnd, const SampleReader& read) {
-	// Calculate weighted sum...
-	double sum = 0;
+SampleReader SampleRateConverter::createUnsafeSampleReader() const {
+	if (!filter) {
+		return [read = inputClip->createSampleReader()](size_type index) {
+			return read(index);
+		};
+	}
 
-	// ... first sample (weight <= 1)
-	const int64_t startIndex = static_cast<int64_t>(inputStart);
-	sum += read(startIndex) * ((startIndex + 1) - inputStart);
+	return [inputClip = inputClip, filter = filter](size_type index) {
+		float sample;
+		resampleBlock(*inputClip, *filter, index, 1, &sample);
+		return sample;
+	};
+}
 
-	// ... middle samples (weight 1 each)
-	const int64_t endIndex = static_cast<int64_t>(inputEnd);
-	for (int64_t index = startIndex + 1; index < endIndex; ++index) {
-		sum += read(index);
+void SampleRateConverter::readUnsafeBlock(size_type start, size_type count, value_type* out) const {
+	if (!filter) {
+		inputClip->readBlock(start, count, out);
+		return;
 	}
 
-	// ... last sample (weight < 1)
-	if (endIndex < inputEnd) {
-		sum += read(endIndex) * (inputEnd - endIndex);
-	}
+	resampleBlock(*inputClip, *filter, start, count, out);
+}
 
-	return static_cast<float>(sum / (inputEnd - inputStart));
+const int16_t* SampleRateConverter::getInt16Samples() const {
+	return filter ? nullptr : inputClip->getInt16Samples();
 }
 
-SampleReader SampleRateConverter::createUnsafeSampleReader() const {
-	return [
-		read = inputClip->createSampleReader(),
-		downscalingFactor = downscalingFactor,
-		size = inputClip->size()
-		](size_type index) {
-		const double inputStart = index * downscalingFactor;
-		const double inputEnd =
-			std::min((index + 1) * downscalingFactor, static_cast<double>(size));
-		return mean(inputStart, inputEnd, read);
-	};
+// Modified Bessel function of the first kind, order 0
+static double besselI0(double x) {
+	double sum = 1;
+	double term = 1;
+	for (int k = 1; term > sum * 1e-12; ++k) {
+		const double factor = x / (2 * k);
+		term *= factor * factor;
+		sum += term;
+	}
+	return sum;
+}
+
+double windowedSinc(double distance, double cutoff, double halfWidth, double beta) {
+	if (std::abs(distance) >= halfWidth) return 0;
+
+	const double pi = 3.14159265358979323846;
+	const double x = cutoff * distance;
+	const double sinc = x == 0 ? 1.0 : std::sin(pi * x) / (pi * x);
+	const double windowPosition = distance / halfWidth;
+	const double window = besselI0(beta * std::sqrt(1 - windowPosition * windowPosition)) / besselI0(beta);
+	return cutoff * sinc * window;
 }
 
 AudioEffect resample(int sampleRate) {
@@ -1,25 +1,49 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 #include "AudioClip.h"
 
+// Converts between sample rates using a windowed-sinc polyphase filter.
+// The output sample rate is inputSampleRate * upFactor / downFactor. For each fractional input
+// position, the filter has one set of taps (a phase), all of which are precomputed.
 class SampleRateConverter : public AudioClip {
 public:
 	SampleRateConverter(std::unique_ptr<AudioClip> inputClip, int outputSampleRate);
 	std::unique_ptr<AudioClip> clone() const override;
 	int getSampleRate() const override;
 	size_type size() const override;
+	const int16_t* getInt16Samples() const override;
+
+	struct Filter {
+		int upFactor;
+		int downFactor;
+		int phaseCount;
+		// Taps per phase, padded with zeros to a multiple of the SIMD width
+		int tapCount;
+		// Input samples before the output position that contribute to it
+		int leadingTapCount;
+		// phaseCount * tapCount taps, phase by phase
+		std::vector<float> taps;
+	};
+
 private:
 	SampleReader createUnsafeSampleReader() const override;
+	void readUnsafeBlock(size_type start, size_type count, value_type* out) const override;
 
 	std::shared_ptr<AudioClip> inputClip;
-	double downscalingFactor; // input sample rate / output sample rate
+	std::shared_ptr<const Filter> filter;
 	int outputSampleRate;
 	int64_t outputSampleCount;
 };
 
 AudioEffect resample(int sampleRate);
 
+// Returns the tap of a lowpass filter at a distance from its center, in input samples.
+// The cutoff frequency is relative to the input Nyquist frequency. The sinc function is shaped by a
+// Kaiser window with parameter beta that reaches zero at halfWidth.
+double windowedSinc(double distance, double cutoff, double halfWidth, double beta);
+
 inline int SampleRateConverter::getSampleRate() const {
 	return outputSampleRate;
 }
@@ -1,15 +1,14 @@
 #include "processing.h"
+#include "DcOffset.h"
+#include "SampleRateConverter.h"
+#include "Int16AudioClip.h"
 #include <algorithm>
 
 using std::function;
 using std::vector;
-
-// Converts a float in the range -1..1 to a signed 16-bit int
-inline int16_t floatSampleToInt16(float sample) {
-	sample = std::max(sample, -1.0f);
-	sample = std::min(sample, 1.0f);
-	return static_cast<int16_t>(((sample + 1) / 2) * (INT16_MAX - INT16_MIN) + INT16_MIN);
-}
+using std::unique_ptr;
+using std::make_unique;
+using std::make_shared;
 
 void process16bitAudioClip(
 	const AudioClip& audioClip,
@@ -21,15 +20,12 @@ void process16bitAudioClip(
 	vector<int16_t> buffer;
 	buffer.reserve(bufferCapacity);
 	size_t sampleCount = 0;
-	auto it = audioClip.begin();
-	const auto end = audioClip.end();
+	const size_t totalSampleCount = static_cast<size_t>(audioClip.size());
 	do {
 		// Read to buffer
-		buffer.clear();
-		for (; buffer.size() < bufferCapacity && it != end; ++it) {
-			// Read sample to buffer
-			buffer.push_back(floatSampleToInt16(*it));
-		}
+		const size_t count = std::min(bufferCapacity, totalSampleCount - sampleCount);
+		buffer.resize(count);
+		audioClip.readBlock(sampleCount, count, buffer.data());
 
 		// Process buffer
 		processBuffer(buffer);
@@ -50,9 +46,32 @@ void process16bitAudioClip(
 
 vector<int16_t> copyTo16bitBuffer(const AudioClip& audioClip) {
 	vector<int16_t> result(static_cast<size_t>(audioClip.size()));
-	int index = 0;
-	for (float sample : audioClip) {
-		result[index++] = floatSampleToInt16(sample);
-	}
+	audioClip.readBlock(0, audioClip.size(), result.data());
 	return result;
 }
+
+unique_ptr<AudioClip> preprocessAudio(
+	const AudioClip& audioClip,
+	int sampleRate,
+	ProgressSink& progressSink
+) {
+	unique_ptr<AudioClip> processedClip = audioClip.clone()
+		| removeDcOffset()
+		| resample(sampleRate);
+
+	// 16-bit audio that needed no processing is used in place
+	if (processedClip->getInt16Samples()) {
+		progressSink.reportProgress(1.0);
+		return processedClip;
+	}
+
+	auto samples = make_shared<vector<int16_t>>();
+	samples->reserve(static_cast<size_t>(processedClip->size()));
+	const auto processBuffer = [&](const vector<int16_t>& buffer) {
+		samples->insert(samples->end(), buffer.begin(), buffer.end());
+	};
+	const size_t capacity = 16384;
+	process16bitAudioClip(*processedClip, processBuffer, capacity, progressSink);
+
+	return make_unique<Int16AudioClip>(std::move(samples), sampleRate);
+}
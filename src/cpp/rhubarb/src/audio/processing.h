@@ -18,4 +18,13 @@ void process16bitAudioClip(
 	ProgressSink& progressSink
 );
 
-std::vector<int16_t> copyTo16bitBuffer(const AudioClip& audioClip);
\ No newline at end of file
+std::vector<int16_t> copyTo16bitBuffer(const AudioClip& audioClip);
+
+// Prepares audio for analysis in a single pass: removes its DC offset, resamples it and converts it
+// to 16 bits. The result provides its samples through getInt16Samples().
+// If the audio needs none of this, the result refers to its samples instead of copying them.
+std::unique_ptr<AudioClip> preprocessAudio(
+	const AudioClip& audioClip,
+	int sampleRate,
+	ProgressSink& progressSink
+);
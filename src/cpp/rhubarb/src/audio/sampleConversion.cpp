@@ -0,0 +1,89 @@
+#include "sampleConversion.h"
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
+// The vector loops below compute exactly the same values as these functions
+
+inline float int16SampleToFloat(int16_t sample) {
+	return sample / 32768.0f;
+}
+
+inline int16_t floatSampleToInt16(float sample) {
+	sample = std::max(sample, -1.0f);
+	sample = std::min(sample, 1.0f);
+	return static_cast<int16_t>(((sample + 1) / 2) * (INT16_MAX - INT16_MIN) + INT16_MIN);
+}
+
+void convertInt16ToFloat(const int16_t* samples, size_t count, float* out) {
+	size_t i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+	const __m128 scale = _mm_set1_ps(1.0f / 32768);
+	for (; i + 8 <= count; i += 8) {
+		const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+		// Sign-extend by placing each value in the upper half of a 32-bit lane
+		const __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16);
+		const __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(values, values), 16);
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+		_mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+	}
+#elif defined(__wasm_simd128__)
+	const v128_t scale = wasm_f32x4_splat(1.0f / 32768);
+	for (; i + 8 <= count; i += 8) {
+		const v128_t values = wasm_v128_load(samples + i);
+		const v128_t low = wasm_f32x4_convert_i32x4(wasm_i32x4_extend_low_i16x8(values));
+		const v128_t high = wasm_f32x4_convert_i32x4(wasm_i32x4_extend_high_i16x8(values));
+		wasm_v128_store(out + i, wasm_f32x4_mul(low, scale));
+		wasm_v128_store(out + i + 4, wasm_f32x4_mul(high, scale));
+	}
+#endif
+	for (; i < count; ++i) {
+		out[i] = int16SampleToFloat(samples[i]);
+	}
+}
+
+void convertFloatToInt16(const float* samples, size_t count, int16_t* out) {
+	size_t i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+	const __m128 min = _mm_set1_ps(-1.0f);
+	const __m128 max = _mm_set1_ps(1.0f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 range = _mm_set1_ps(INT16_MAX - INT16_MIN);
+	const __m128 offset = _mm_set1_ps(INT16_MIN);
+	const auto convert = [&](__m128 values) {
+		values = _mm_min_ps(_mm_max_ps(values, min), max);
+		values = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(_mm_add_ps(values, one), half), range), offset);
+		return _mm_cvttps_epi32(values);
+	};
+	for (; i + 8 <= count; i += 8) {
+		const __m128i low = convert(_mm_loadu_ps(samples + i));
+		const __m128i high = convert(_mm_loadu_ps(samples + i + 4));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(low, high));
+	}
+#elif defined(__wasm_simd128__)
+	const v128_t min = wasm_f32x4_splat(-1.0f);
+	const v128_t max = wasm_f32x4_splat(1.0f);
+	const v128_t one = wasm_f32x4_splat(1.0f);
+	const v128_t half = wasm_f32x4_splat(0.5f);
+	const v128_t range = wasm_f32x4_splat(INT16_MAX - INT16_MIN);
+	const v128_t offset = wasm_f32x4_splat(INT16_MIN);
+	const auto convert = [&](v128_t values) {
+		values = wasm_f32x4_min(wasm_f32x4_max(values, min), max);
+		values = wasm_f32x4_add(wasm_f32x4_mul(wasm_f32x4_mul(wasm_f32x4_add(values, one), half), range), offset);
+		return wasm_i32x4_trunc_sat_f32x4(values);
+	};
+	for (; i + 8 <= count; i += 8) {
+		const v128_t low = convert(wasm_v128_load(samples + i));
+		const v128_t high = convert(wasm_v128_load(samples + i + 4));
+		wasm_v128_store(out + i, wasm_i16x8_narrow_i32x4(low, high));
+	}
+#endif
+	for (; i < count; ++i) {
+		out[i] = floatSampleToInt16(samples[i]);
+	}
+}
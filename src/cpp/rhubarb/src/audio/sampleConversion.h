@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Converts 16-bit samples to floats in the range -1..1
+void convertInt16ToFloat(const int16_t* samples, size_t count, float* out);
+
+// Converts floats in the range -1..1 to 16-bit samples. Values outside that range are clamped.
+void convertFloatToInt16(const float* samples, size_t count, int16_t* out);
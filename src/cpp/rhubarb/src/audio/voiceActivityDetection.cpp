@@ -1,14 +1,15 @@
 #include "voiceActivityDetection.h"
-#include "DcOffset.h"
 #include "SampleRateConverter.h"
+#include "HalfBandDecimator.h"
 #include "logging/logging.h"
-#include "tools/pairs.h"
 #include <boost/range/adaptor/transformed.hpp>
 #include <webrtc/common_audio/vad/include/webrtc_vad.h>
 #include "processing.h"
 #include <gsl_util.h>
 #include "tools/parallel.h"
 #include <webrtc/common_audio/vad/vad_core.h>
+#include <algorithm>
+#include <limits>
 
 using std::vector;
 using boost::adaptors::transformed;
@@ -16,71 +17,101 @@ using fmt::format;
 using std::runtime_error;
 using std::unique_ptr;
 
-JoiningBoundedTimeline<void> detectVoiceActivity(
-	const AudioClip& inputAudioClip,
-	ProgressSink& progressSink
-) {
-	// Prepare audio for VAD
-	constexpr int webRtcSamplingRate = 8000;
-	const unique_ptr<AudioClip> audioClip = inputAudioClip.clone()
-		| resample(webRtcSamplingRate)
-		| removeDcOffset();
+// Gaps in activity up to this length are filled
+constexpr centiseconds maxGap(10);
+// Segments of activity shorter than this are discarded
+constexpr centiseconds minSegmentLength(5);
 
-	VadInst* vadHandle = WebRtcVad_Create();
+VoiceActivityDetector::VoiceActivityDetector() :
+	vadHandle(WebRtcVad_Create(), [](VadInst* handle) { WebRtcVad_Free(handle); })
+{
 	if (!vadHandle) throw runtime_error("Error creating WebRTC VAD handle.");
 
-	auto freeHandle = gsl::finally([&]() { WebRtcVad_Free(vadHandle); });
-
-	int error = WebRtcVad_Init(vadHandle);
+	int error = WebRtcVad_Init(vadHandle.get());
 	if (error) throw runtime_error("Error initializing WebRTC VAD.");
 
 	const int aggressiveness = 2; // 0..3. The higher, the more is cut off.
-	error = WebRtcVad_set_mode(vadHandle, aggressiveness);
+	error = WebRtcVad_set_mode(vadHandle.get(), aggressiveness);
 	if (error) throw runtime_error("Error setting WebRTC VAD aggressiveness.");
+}
 
-	// Detect activity
-	JoiningBoundedTimeline<void> activity(audioClip->getTruncatedRange());
-	centiseconds time = 0_cs;
-	const size_t frameSize = webRtcSamplingRate / 100;
-	const auto processBuffer = [&](const vector<int16_t>& buffer) {
-		// WebRTC is picky regarding buffer size
-		if (buffer.size() < frameSize) return;
-
-		const int result = WebRtcVad_Process(
-			vadHandle,
-			webRtcSamplingRate,
-			buffer.data(),
-			buffer.size()
-		);
-		if (result == -1) throw runtime_error("Error processing audio buffer using WebRTC VAD.");
+void VoiceActivityDetector::processFrame(const int16_t* frame) {
+	const int result = WebRtcVad_Process(vadHandle.get(), sampleRate, frame, frameSize);
+	if (result == -1) throw runtime_error("Error processing audio buffer using WebRTC VAD.");
 
-		// Ignore the result of WebRtcVad_Process, instead directly interpret the internal VAD flag.
-		// The result of WebRtcVad_Process stays 1 for a number of frames after the last detected
-		// activity.
-		const bool isActive = reinterpret_cast<VadInstT*>(vadHandle)->vad == 1;
+	// Ignore the result of WebRtcVad_Process, instead directly interpret the internal VAD flag.
+	// The result of WebRtcVad_Process stays 1 for a number of frames after the last detected
+	// activity.
+	const bool isActive = reinterpret_cast<VadInstT*>(vadHandle.get())->vad == 1;
 
-		if (isActive) {
-			activity.set(time, time + 1_cs);
+	if (isActive) {
+		if (openUtterance && time - openUtterance->getEnd() <= maxGap) {
+			// Fill small gap
+			openUtterance->setEnd(time + 1_cs);
+		} else {
+			completeOpenUtterance();
+			openUtterance = TimeRange(time, time + 1_cs);
 		}
+	}
 
-		time += 1_cs;
-	};
-	process16bitAudioClip(*audioClip, processBuffer, frameSize, progressSink);
+	time += 1_cs;
 
-	// Fill small gaps in activity
-	const centiseconds maxGap(10);
-	for (const auto& pair : getPairs(activity)) {
-		if (pair.second.getStart() - pair.first.getEnd() <= maxGap) {
-			activity.set(pair.first.getEnd(), pair.second.getStart());
-		}
+	// Once the gap is too large to be filled, the utterance can't change any more
+	if (openUtterance && time - openUtterance->getEnd() > maxGap) {
+		completeOpenUtterance();
 	}
+}
+
+void VoiceActivityDetector::finish() {
+	completeOpenUtterance();
+}
+
+std::vector<TimeRange> VoiceActivityDetector::takeCompletedUtterances() {
+	std::vector<TimeRange> result;
+	result.swap(completedUtterances);
+	return result;
+}
+
+void VoiceActivityDetector::completeOpenUtterance() {
+	if (!openUtterance) return;
 
 	// Discard very short segments of activity
-	const centiseconds minSegmentLength(5);
-	for (const auto& segment : Timeline<void>(activity)) {
-		if (segment.getDuration() < minSegmentLength) {
-			activity.clear(segment.getTimeRange());
+	if (openUtterance->getDuration() >= minSegmentLength) {
+		completedUtterances.push_back(*openUtterance);
+	}
+	openUtterance = boost::none;
+}
+
+VoiceActivity detectVoiceActivity(
+	const AudioClip& inputAudioClip,
+	ProgressSink& progressSink
+) {
+	// Prepare audio for VAD. Audio at twice the VAD sample rate only needs a half-band filter.
+	const bool isDoubleRate = inputAudioClip.getSampleRate() == 2 * VoiceActivityDetector::sampleRate;
+	const unique_ptr<AudioClip> audioClip = inputAudioClip.clone()
+		| (isDoubleRate ? decimateByTwo() : resample(VoiceActivityDetector::sampleRate));
+
+	// Detect activity
+	VoiceActivityDetector voiceActivityDetector;
+	vector<float> frameEnergies;
+	const auto processBuffer = [&](const vector<int16_t>& buffer) {
+		// WebRTC is picky regarding buffer size
+		if (buffer.size() < VoiceActivityDetector::frameSize) return;
+
+		voiceActivityDetector.processFrame(buffer.data());
+
+		double energy = 0;
+		for (int16_t sample : buffer) {
+			energy += static_cast<double>(sample) * sample;
 		}
+		frameEnergies.push_back(static_cast<float>(energy / buffer.size()));
+	};
+	process16bitAudioClip(*audioClip, processBuffer, VoiceActivityDetector::frameSize, progressSink);
+	voiceActivityDetector.finish();
+
+	JoiningBoundedTimeline<void> activity(audioClip->getTruncatedRange());
+	for (const TimeRange& utterance : voiceActivityDetector.takeCompletedUtterances()) {
+		activity.set(utterance);
 	}
 
 	logging::debugFormat(
@@ -91,5 +122,76 @@ JoiningBoundedTimeline<void> detectVoiceActivity(
 		}), ", ")
 	);
 
-	return activity;
+	return { activity, std::move(frameEnergies) };
+}
+
+// Returns the time within the search range around which the energy is lowest. Looks at a few
+// frames at a time, so that a single quiet frame within a sound doesn't count as a pause.
+static centiseconds findQuietestTime(const vector<float>& frameEnergies, TimeRange searchRange) {
+	constexpr int windowRadius = 2;
+	const int frameCount = static_cast<int>(frameEnergies.size());
+
+	centiseconds result = searchRange.getStart() + searchRange.getDuration() / 2;
+	double lowestEnergy = std::numeric_limits<double>::infinity();
+	for (centiseconds time = searchRange.getStart(); time < searchRange.getEnd(); ++time) {
+		const int center = static_cast<int>(time.count());
+		double energy = 0;
+		for (int frame = std::max(center - windowRadius, 0); frame <= std::min(center + windowRadius, frameCount - 1); ++frame) {
+			energy += frameEnergies[frame];
+		}
+		if (energy < lowestEnergy) {
+			lowestEnergy = energy;
+			result = time;
+		}
+	}
+	return result;
+}
+
+BoundedTimeline<void> splitLongUtterances(
+	const VoiceActivity& voiceActivity,
+	centiseconds maxDuration
+) {
+	// An utterance split into n parts is longer than (n - 1) * maxDuration, so parts of at least
+	// half that always fit
+	const centiseconds minDuration = maxDuration / 2;
+
+	const JoiningBoundedTimeline<void>& utterances = voiceActivity.utterances;
+	BoundedTimeline<void> result(utterances.getRange());
+	for (const auto& utterance : utterances) {
+		const centiseconds duration = utterance.getDuration();
+		const int partCount = static_cast<int>((duration + maxDuration - 1_cs) / maxDuration);
+		centiseconds partStart = utterance.getStart();
+		for (int partIndex = 1; partIndex < partCount; ++partIndex) {
+			// Leave room for the remaining parts, each between minDuration and maxDuration long
+			const int remainingPartCount = partCount - partIndex;
+			const centiseconds earliestCut =
+				std::max(partStart + minDuration, utterance.getEnd() - maxDuration * remainingPartCount);
+			const centiseconds latestCut =
+				std::min(partStart + maxDuration, utterance.getEnd() - minDuration * remainingPartCount);
+
+			// Look for a pause within a quarter part of the even cut
+			const centiseconds evenCut = utterance.getStart() + duration * partIndex / partCount;
+			const centiseconds radius = duration / partCount / 4;
+			const centiseconds searchStart = std::max(evenCut - radius, earliestCut);
+			const centiseconds searchEnd = std::min(evenCut + radius, latestCut);
+			const centiseconds cut = searchStart <= searchEnd
+				? findQuietestTime(voiceActivity.frameEnergies, TimeRange(searchStart, searchEnd + 1_cs))
+				: std::clamp(evenCut, earliestCut, latestCut);
+			result.set(partStart, cut);
+			partStart = cut;
+		}
+		result.set(partStart, utterance.getEnd());
+	}
+
+	if (result.size() != utterances.size()) {
+		logging::debugFormat(
+			"Split long utterances into {} parts: {}",
+			result.size(),
+			join(result | transformed([](const Timed<void>& t) {
+				return format("{0}-{1}", t.getStart(), t.getEnd());
+			}), ", ")
+		);
+	}
+
+	return result;
 }
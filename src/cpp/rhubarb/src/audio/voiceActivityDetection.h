@@ -2,8 +2,66 @@
 #include "AudioClip.h"
 #include "time/BoundedTimeline.h"
 #include "tools/progress.h"
+#include "tools/tools.h"
+#include <boost/optional.hpp>
+#include <vector>
 
-JoiningBoundedTimeline<void> detectVoiceActivity(
+struct WebRtcVadInst;
+
+// Detects voice activity in a stream of 16-bit audio, one 10ms frame at a time.
+// An utterance is reported as soon as it is complete, i.e. once it is followed by enough silence
+// that it can neither grow nor be merged with later activity.
+class VoiceActivityDetector {
+public:
+	static constexpr int sampleRate = 8000;
+	static constexpr size_t frameSize = sampleRate / 100;
+
+	VoiceActivityDetector();
+
+	// Processes a frame of frameSize samples at sampleRate
+	void processFrame(const int16_t* frame);
+
+	// Completes any open utterance. Call this after the last frame.
+	void finish();
+
+	// Returns the utterances completed since the last call
+	std::vector<TimeRange> takeCompletedUtterances();
+
+	// Returns the end time of the audio processed so far
+	centiseconds getTime() const {
+		return time;
+	}
+
+	// Returns the start of the utterance that may still grow, if any
+	boost::optional<centiseconds> getOpenUtteranceStart() const {
+		return openUtterance ? boost::optional<centiseconds>(openUtterance->getStart()) : boost::none;
+	}
+
+private:
+	void completeOpenUtterance();
+
+	lambda_unique_ptr<WebRtcVadInst> vadHandle;
+	centiseconds time = 0_cs;
+	boost::optional<TimeRange> openUtterance;
+	std::vector<TimeRange> completedUtterances;
+};
+
+struct VoiceActivity {
+	JoiningBoundedTimeline<void> utterances;
+	// Mean square amplitude of each 10ms VAD frame, indexed by centisecond
+	std::vector<float> frameEnergies;
+};
+
+// Detects utterances in audio without a DC offset
+VoiceActivity detectVoiceActivity(
 	const AudioClip& audioClip,
 	ProgressSink& progressSink
 );
+
+// Splits utterances longer than maxDuration into parts between maxDuration / 2 and maxDuration long.
+// Each cut is placed at the quietest point near an even division of the utterance.
+// Unlike the utterances, adjacent parts are separate elements of the timeline.
+BoundedTimeline<void> splitLongUtterances(
+	const VoiceActivity& voiceActivity,
+	centiseconds maxDuration
+);
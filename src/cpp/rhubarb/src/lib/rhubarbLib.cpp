@@ -0,0 +1,21 @@
+#include "rhubarbLib.h"
+#include "logging/logging.h"
+
+using std::vector;
+using std::string;
+using boost::optional;
+
+vector<MouthCue> animateAudioClip(
+	const AudioClip& audioClip,
+	const optional<string>& dialog,
+	const Recognizer& recognizer,
+	int maxThreadCount,
+	ProgressSink& progressSink
+) {
+	const BoundedTimeline<Phone> phones =
+		recognizer.recognizePhones(audioClip, dialog, maxThreadCount, progressSink);
+	logging::debug("Phone recognition complete");
+
+	const double audioDurationSeconds = static_cast<double>(audioClip.size()) / audioClip.getSampleRate();
+	return processPhones(phones, audioDurationSeconds);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "animation/mouthCues.h"
+#include "audio/AudioClip.h"
+#include "recognition/Recognizer.h"
+#include "tools/progress.h"
+#include <boost/optional.hpp>
+
+// Recognizes the phones in an audio clip and animates them.
+// This is the code path shared by all front ends (WASM bindings and command line).
+std::vector<MouthCue> animateAudioClip(
+	const AudioClip& audioClip,
+	const boost::optional<std::string>& dialog,
+	const Recognizer& recognizer,
+	int maxThreadCount,
+	ProgressSink& progressSink
+);
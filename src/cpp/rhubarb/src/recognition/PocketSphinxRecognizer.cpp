@@ -1,22 +1,27 @@
 #include "PocketSphinxRecognizer.h"
 #include <regex>
-#include <gsl_util.h>
-#include "audio/AudioSegment.h"
-#include "audio/SampleRateConverter.h"
+#include <sstream>
+#include <iterator>
+#include <mutex>
+#include <set>
+#include <tuple>
+#include <algorithm>
 #include "languageModels.h"
 #include "tokenization.h"
 #include "g2p.h"
 #include "time/ContinuousTimeline.h"
-#include "audio/processing.h"
 #include "time/timedLogging.h"
 
 extern "C" {
 #include <state_align_search.h>
+#include <ngram_model_trie.h>
 }
 
 using std::runtime_error;
 using std::invalid_argument;
 using std::unique_ptr;
+using std::shared_ptr;
+using std::weak_ptr;
 using std::string;
 using std::vector;
 using std::map;
@@ -26,6 +31,11 @@ using std::regex_replace;
 using boost::optional;
 using std::array;
 
+// Name of the search using the default language model
+static const char* const defaultSearchName = "lm";
+// Name of the search using a dialog-biased language model
+static const char* const dialogSearchName = "dialog";
+
 bool dictionaryContains(dict_t& dictionary, const string& word) {
 	return dict_wordid(&dictionary, word.c_str()) != BAD_S3WID;
 }
@@ -36,29 +46,141 @@ s3wid_t getWordId(const string& word, dict_t& dictionary) {
 	return wordId;
 }
 
-void addMissingDictionaryWords(const vector<string>& words, ps_decoder_t& decoder) {
+// Adds a word to the decoder's dictionary.
+// Unlike ps_add_word, this leaves existing searches and their language models untouched.
+// That way, dialog-specific words don't leak into the default language model of a pooled decoder.
+void addDictionaryWord(const string& word, const string& pronunciation, ps_decoder_t& decoder) {
+	vector<s3cipid_t> phoneIds;
+	std::istringstream phoneNames(pronunciation);
+	for (string phoneName; phoneNames >> phoneName;) {
+		const s3cipid_t phoneId = bin_mdef_ciphone_id(decoder.acmod->mdef, phoneName.c_str());
+		if (phoneId == BAD_S3CIPID) {
+			throw invalid_argument(fmt::format("Unknown phone '{}' in pronunciation of '{}'.", phoneName, word));
+		}
+		phoneIds.push_back(phoneId);
+	}
+
+	const s3wid_t wordId =
+		dict_add_word(decoder.dict, word.c_str(), phoneIds.data(), static_cast<int32>(phoneIds.size()));
+	if (wordId == BAD_S3WID) throw runtime_error(fmt::format("Error adding word '{}' to dictionary.", word));
+	dict2pid_add_word(decoder.d2p, wordId);
+}
+
+// Returns whether a word is in the pronunciation dictionary the decoder was created with.
+// Words added for earlier dialogs don't count, so that every decoder yields the same result.
+bool mainDictionaryContains(dict_t& dictionary, const string& word) {
+	const s3wid_t wordId = dict_wordid(&dictionary, word.c_str());
+	return wordId != BAD_S3WID && wordId < dict_filler_start(&dictionary);
+}
+
+// Text-side work for a dialog. It is done once per request and shared by all decoders.
+struct PreparedDialog {
+	// Normalized words of the dialog
+	vector<string> words;
+	// Number of phones in the pronunciation of each word
+	vector<int> phoneCounts;
+	// Guessed pronunciations of words missing from the dictionary
+	map<string, string> missingPronunciations;
+	// Language model over the normalized words of the dialog
+	TrigramModel languageModel;
+};
+
+// Range of word indexes within a dialog
+struct WordRange {
+	size_t begin;
+	size_t end;
+
+	bool operator<(const WordRange& other) const {
+		return std::tie(begin, end) < std::tie(other.begin, other.end);
+	}
+};
+
+map<string, string> guessMissingPronunciations(const vector<string>& words, dict_t& dictionary) {
 	map<string, string> missingPronunciations;
 	for (const string& word : words) {
-		if (!dictionaryContains(*decoder.dict, word)) {
+		if (!mainDictionaryContains(dictionary, word) && !missingPronunciations.count(word)) {
 			string pronunciation;
 			for (Phone phone : wordToPhones(word)) {
 				if (pronunciation.length() > 0) pronunciation += " ";
 				pronunciation += PhoneConverter::get().toString(phone);
 			}
+			logging::infoFormat("Unknown word '{}'. Guessing pronunciation '{}'.", word, pronunciation);
 			missingPronunciations[word] = pronunciation;
 		}
 	}
-	for (auto it = missingPronunciations.begin(); it != missingPronunciations.end(); ++it) {
-		const bool isLast = it == --missingPronunciations.end();
-		logging::infoFormat("Unknown word '{}'. Guessing pronunciation '{}'.", it->first, it->second);
-		ps_add_word(&decoder, it->first.c_str(), it->second.c_str(), isLast);
+	return missingPronunciations;
+}
+
+// Returns the default language model a pooled decoder was created with
+ngram_model_t& getDefaultLanguageModel(ps_decoder_t& decoder) {
+	// The search wraps its language model in a set containing a single model called "default"
+	ngram_model_t* languageModelSet = ps_get_lm(&decoder, defaultSearchName);
+	ngram_model_t* result = languageModelSet
+		? ngram_model_set_lookup(languageModelSet, "default")
+		: nullptr;
+	if (!result) throw runtime_error("Decoder has no default language model.");
+
+	return *result;
+}
+
+// Adds dialog-specific words to the dictionary
+void addMissingWords(ps_decoder_t& decoder, const PreparedDialog& dialog) {
+	for (const auto& pair : dialog.missingPronunciations) {
+		if (!dictionaryContains(*decoder.dict, pair.first)) {
+			addDictionaryWord(pair.first, pair.second, decoder);
+		}
+	}
+}
+
+// Prepares a dialog, using the decoder only to look up words
+static shared_ptr<const PreparedDialog> prepareDialog(const string& dialog, ps_decoder_t& decoder) {
+	// Split dialog into normalized words
+	vector<string> words = tokenizeText(
+		dialog,
+		[&](const string& word) { return mainDictionaryContains(*decoder.dict, word); }
+	);
+
+	auto preparedDialog = std::make_shared<PreparedDialog>();
+	preparedDialog->missingPronunciations = guessMissingPronunciations(words, *decoder.dict);
+	preparedDialog->words = words;
+	for (const string& word : words) {
+		const auto missingPronunciation = preparedDialog->missingPronunciations.find(word);
+		if (missingPronunciation != preparedDialog->missingPronunciations.end()) {
+			std::istringstream phoneNames(missingPronunciation->second);
+			preparedDialog->phoneCounts.push_back(static_cast<int>(std::distance(
+				std::istream_iterator<string>(phoneNames), std::istream_iterator<string>())));
+		} else {
+			preparedDialog->phoneCounts.push_back(dict_pronlen(decoder.dict, getWordId(word, *decoder.dict)));
+		}
 	}
+
+	words.insert(words.begin(), "<s>");
+	words.emplace_back("</s>");
+	preparedDialog->languageModel = createTrigramModel(words);
+	return preparedDialog;
 }
 
-lambda_unique_ptr<ngram_model_t> createDefaultLanguageModel(ps_decoder_t& decoder) {
-	path modelPath = getSphinxModelDirectory() / "en-us.lm.bin";
+static path getDefaultLanguageModelPath(LanguageModelVariant variant) {
+	return getSphinxModelDirectory()
+		/ (variant == LanguageModelVariant::Compact ? "en-us-compact.lm.bin" : "en-us.lm.bin");
+}
+
+// Reads the default language model for a decoder.
+// If the other model was mapped from the same file, the new one shares its mapping.
+lambda_unique_ptr<ngram_model_t> createDefaultLanguageModel(
+	ps_decoder_t& decoder,
+	const path& modelPath,
+	ngram_model_t* other
+) {
+	// Only binary models can be shared
+	ngram_model_t* languageModel = other
+		? ngram_model_trie_read_bin_shared(decoder.config, modelPath.u8string().c_str(), decoder.lmath, other)
+		: nullptr;
+	if (!languageModel) {
+		languageModel = ngram_model_read(decoder.config, modelPath.u8string().c_str(), NGRAM_AUTO, decoder.lmath);
+	}
 	lambda_unique_ptr<ngram_model_t> result(
-		ngram_model_read(decoder.config, modelPath.u8string().c_str(), NGRAM_AUTO, decoder.lmath),
+		languageModel,
 		[](ngram_model_t* lm) { ngram_model_free(lm); });
 	if (!result) {
 		throw runtime_error(fmt::format("Error reading language model from {}.", modelPath.u8string()));
@@ -69,32 +191,27 @@ lambda_unique_ptr<ngram_model_t> createDefaultLanguageModel(ps_decoder_t& decode
 
 lambda_unique_ptr<ngram_model_t> createDialogLanguageModel(
 	ps_decoder_t& decoder,
-	const string& dialog
+	const PreparedDialog& dialog
 ) {
-	// Split dialog into normalized words
-	vector<string> words = tokenizeText(
-		dialog,
-		[&](const string& word) { return dictionaryContains(*decoder.dict, word); }
-	);
+	addMissingWords(decoder, dialog);
 
-	// Add dialog-specific words to the dictionary
-	addMissingDictionaryWords(words, decoder);
+	lambda_unique_ptr<ngram_model_t> result = createLanguageModel(dialog.languageModel, decoder);
+	if (!result) throw runtime_error("Error creating dialog language model.");
 
-	// Create dialog-specific language model
-	words.insert(words.begin(), "<s>");
-	words.emplace_back("</s>");
-	return createLanguageModel(words, decoder);
+	return result;
 }
 
+// Interpolates the shared default language model with the small dialog model.
+// Only words of the dialog are looked up in both models; all others only in the default one.
 lambda_unique_ptr<ngram_model_t> createBiasedLanguageModel(
 	ps_decoder_t& decoder,
-	const string& dialog
+	const PreparedDialog& dialog
 ) {
-	auto defaultLanguageModel = createDefaultLanguageModel(decoder);
+	ngram_model_t& defaultLanguageModel = getDefaultLanguageModel(decoder);
 	auto dialogLanguageModel = createDialogLanguageModel(decoder, dialog);
 	constexpr int modelCount = 2;
 	array<ngram_model_t*, modelCount> languageModels {
-		defaultLanguageModel.get(),
+		&defaultLanguageModel,
 		dialogLanguageModel.get()
 	};
 	array<const char*, modelCount> modelNames { "defaultLM", "dialogLM" };
@@ -115,14 +232,29 @@ lambda_unique_ptr<ngram_model_t> createBiasedLanguageModel(
 	return result;
 }
 
-static lambda_unique_ptr<ps_decoder_t> createDecoder(optional<std::string> dialog) {
+// The compiled dictionary is mapped into memory rather than parsed, so loading it is nearly free
+static path getCompiledDictionaryPath() {
+	return getSphinxModelDirectory() / "cmudict-en-us.dict.bin";
+}
+
+static bool hasCompiledDictionary() {
+	return std::filesystem::exists(getCompiledDictionaryPath());
+}
+
+static path getDictionaryPath() {
+	return hasCompiledDictionary()
+		? getCompiledDictionaryPath()
+		: getSphinxModelDirectory() / "cmudict-en-us.dict";
+}
+
+static lambda_unique_ptr<cmd_ln_t> createConfig() {
 	lambda_unique_ptr<cmd_ln_t> config(
 		cmd_ln_init(
 			nullptr, ps_args(), true,
 			// Set acoustic model
 			"-hmm", (getSphinxModelDirectory() / "acoustic-model").u8string().c_str(),
 			// Set pronunciation dictionary
-			"-dict", (getSphinxModelDirectory() / "cmudict-en-us.dict").u8string().c_str(),
+			"-dict", getDictionaryPath().u8string().c_str(),
 			// Add noise against zero silence
 			// (see http://cmusphinx.sourceforge.net/wiki/faq#qwhy_my_accuracy_is_poor)
 			"-dither", "yes",
@@ -134,28 +266,153 @@ static lambda_unique_ptr<ps_decoder_t> createDecoder(optional<std::string> dialo
 		[](cmd_ln_t* config) { cmd_ln_free_r(config); });
 	if (!config) throw runtime_error("Error creating configuration.");
 
-	lambda_unique_ptr<ps_decoder_t> decoder(
+	return config;
+}
+
+// PocketSphinx reference counts aren't thread-safe.
+// Decoders sharing an acoustic model or language model must be created and freed one at a time.
+static std::mutex acousticModelMutex;
+
+// Returns the acoustic model shared by all decoders in the process.
+// It is loaded on first use and freed once the last decoder using it is gone.
+static shared_ptr<ps_decoder_t> getSharedAcousticModel() {
+	static std::mutex cacheMutex;
+	static weak_ptr<ps_decoder_t> cache;
+
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	if (shared_ptr<ps_decoder_t> acousticModel = cache.lock()) {
+		return acousticModel;
+	}
+
+	// The acoustic model is held by a minimal decoder without language model.
+	// A compiled dictionary is loaded as well so that decoders share it; a text dictionary isn't,
+	// because each decoder parses its own copy anyway.
+	lambda_unique_ptr<cmd_ln_t> config = createConfig();
+	if (!hasCompiledDictionary()) {
+		cmd_ln_set_str_r(config.get(), "-dict", nullptr);
+	}
+	shared_ptr<ps_decoder_t> acousticModel(
 		ps_init(config.get()),
-		[](ps_decoder_t* recognizer) { ps_free(recognizer); });
+		[](ps_decoder_t* decoder) {
+			std::lock_guard<std::mutex> lock(acousticModelMutex);
+			ps_free(decoder);
+		});
+	if (!acousticModel) throw runtime_error("Error loading acoustic model.");
+
+	cache = acousticModel;
+	return acousticModel;
+}
+
+// Returns a decoder holding the default search for a language model, shared by all decoders in
+// the process that use this model. It is never used for decoding. Instead, new decoders take what
+// doesn't depend on the audio from it: they share its compiled dictionary, triphone tables and
+// mapped language model, and copy its mapping from dictionary words to language model words.
+// Building the search only takes a fraction of the time after that.
+static shared_ptr<ps_decoder_t> getSharedDefaultSearch(const path& languageModelPath) {
+	static std::mutex cacheMutex;
+	static map<path, weak_ptr<ps_decoder_t>> cache;
+
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	if (shared_ptr<ps_decoder_t> defaultSearch = cache[languageModelPath].lock()) {
+		return defaultSearch;
+	}
+
+	const shared_ptr<ps_decoder_t> acousticModel = getSharedAcousticModel();
+	lambda_unique_ptr<cmd_ln_t> config = createConfig();
+	shared_ptr<ps_decoder_t> defaultSearch;
+	{
+		std::lock_guard<std::mutex> acousticModelLock(acousticModelMutex);
+		defaultSearch = shared_ptr<ps_decoder_t>(
+			ps_init_shared(config.get(), acousticModel.get()),
+			[acousticModel](ps_decoder_t* decoder) {
+				std::lock_guard<std::mutex> lock(acousticModelMutex);
+				ps_free(decoder);
+			});
+	}
+	if (!defaultSearch) throw runtime_error("Error creating speech decoder.");
+
+	{
+		std::lock_guard<std::mutex> acousticModelLock(acousticModelMutex);
+		lambda_unique_ptr<ngram_model_t> languageModel =
+			createDefaultLanguageModel(*defaultSearch, languageModelPath, nullptr);
+		if (ps_set_lm(defaultSearch.get(), defaultSearchName, languageModel.get())) {
+			throw runtime_error("Error creating default search.");
+		}
+	}
+
+	cache[languageModelPath] = defaultSearch;
+	return defaultSearch;
+}
+
+static lambda_unique_ptr<ps_decoder_t> createDecoder(const path& languageModelPath) {
+	redirectPocketSphinxOutput();
+
+	const shared_ptr<ps_decoder_t> defaultSearch = getSharedDefaultSearch(languageModelPath);
+	lambda_unique_ptr<cmd_ln_t> config = createConfig();
+	lambda_unique_ptr<ps_decoder_t> decoder;
+	{
+		std::lock_guard<std::mutex> lock(acousticModelMutex);
+		// Each decoder keeps the shared models alive
+		decoder = lambda_unique_ptr<ps_decoder_t>(
+			ps_init_shared(config.get(), defaultSearch.get()),
+			[defaultSearch](ps_decoder_t* decoder) {
+				std::lock_guard<std::mutex> lock(acousticModelMutex);
+				ps_free(decoder);
+			});
+	}
 	if (!decoder) throw runtime_error("Error creating speech decoder.");
 
-	// Set language model
-	lambda_unique_ptr<ngram_model_t> languageModel(dialog
-		? createBiasedLanguageModel(*decoder, *dialog)
-		: createDefaultLanguageModel(*decoder));
-	ps_set_lm(decoder.get(), "lm", languageModel.get());
-	ps_set_search(decoder.get(), "lm");
+	// Set default language model
+	{
+		std::lock_guard<std::mutex> lock(acousticModelMutex);
+		lambda_unique_ptr<ngram_model_t> languageModel = createDefaultLanguageModel(
+			*decoder, languageModelPath, &getDefaultLanguageModel(*defaultSearch));
+		if (ps_set_lm_shared(decoder.get(), defaultSearchName, languageModel.get(), defaultSearch.get())) {
+			throw runtime_error("Error creating default search.");
+		}
+	}
+	ps_set_search(decoder.get(), defaultSearchName);
 
 	return decoder;
 }
 
-optional<Timeline<Phone>> getPhoneAlignment(
-	const vector<s3wid_t>& wordIds,
-	const vector<int16_t>& audioBuffer,
-	ps_decoder_t& decoder)
-{
-	if (wordIds.empty()) return boost::none;
+// Activates a search biased towards the specified dialog.
+// With a grammar, the search only considers the words of the dialog.
+static void attachDialog(ps_decoder_t& decoder, const PreparedDialog& dialog, bool useGrammar) {
+	if (useGrammar) {
+		addMissingWords(decoder, dialog);
+		lambda_unique_ptr<fsg_model_t> grammar = createDialogGrammar(dialog.words, decoder);
+		if (!grammar) throw runtime_error("Error creating dialog grammar.");
+		if (ps_set_fsg(&decoder, dialogSearchName, grammar.get())) {
+			throw runtime_error("Error creating dialog search.");
+		}
+	} else {
+		lambda_unique_ptr<ngram_model_t> languageModel = createBiasedLanguageModel(decoder, dialog);
+		if (ps_set_lm(&decoder, dialogSearchName, languageModel.get())) {
+			throw runtime_error("Error creating dialog search.");
+		}
+	}
+	ps_set_search(&decoder, dialogSearchName);
+}
+
+// Reverts a decoder to its default search and frees the dialog search.
+// Words added for the dialog are removed, so that pooled decoders don't accumulate the words of all
+// dialogs they ever saw.
+static void detachDialog(ps_decoder_t& decoder, s3wid_t dictionarySize) {
+	ps_set_search(&decoder, defaultSearchName);
+	ps_unset_search(&decoder, dialogSearchName);
+	dict_truncate(decoder.dict, dictionarySize);
+}
+
+// Alignment of words with the utterance whose features are in the decoder's acoustic model
+struct WordAlignment {
+	lambda_unique_ptr<ps_alignment_t> alignment;
+	lambda_unique_ptr<ps_search_t> search;
+	// Viterbi score of the best path, once aligned. Higher is better.
+	optional<int32> score;
+};
 
+WordAlignment createWordAlignment(const vector<s3wid_t>& wordIds, ps_decoder_t& decoder) {
 	// Create alignment list
 	lambda_unique_ptr<ps_alignment_t> alignment(
 		ps_alignment_init(decoder.d2p),
@@ -169,44 +426,62 @@ optional<Timeline<Phone>> getPhoneAlignment(
 	if (error) throw runtime_error("Error populating alignment struct.");
 
 	// Create search structure
-	acmod_t* acousticModel = decoder.acmod;
 	lambda_unique_ptr<ps_search_t> search(
-		state_align_search_init("state_align", decoder.config, acousticModel, alignment.get()),
+		state_align_search_init("state_align", decoder.config, decoder.acmod, alignment.get()),
 		[](ps_search_t* search) { ps_search_free(search); });
 	if (!search) throw runtime_error("Error creating search.");
 
-	// Start recognition
-	error = acmod_start_utt(acousticModel);
-	if (error) throw runtime_error("Error starting utterance processing for alignment.");
+	return WordAlignment { std::move(alignment), std::move(search), boost::none };
+}
 
-	{
-		// Eventually end recognition
-		auto endRecognition = gsl::finally([&]() { acmod_end_utt(acousticModel); });
-
-		// Start search
-		ps_search_start(search.get());
-
-		// Process entire audio clip
-		const int16* nextSample = audioBuffer.data();
-		size_t remainingSamples = audioBuffer.size();
-		const bool fullUtterance = true;
-		while (acmod_process_raw(acousticModel, &nextSample, &remainingSamples, fullUtterance) > 0) {
-			while (acousticModel->n_feat_frame > 0) {
-				ps_search_step(search.get(), acousticModel->output_frame);
-				acmod_advance(acousticModel);
-			}
-		}
+// Marks the senones of all phones of an alignment as active.
+// The alignment search never clears active senones, and scores are normalized against the best
+// active senone per frame. So alignments are only comparable if they see the same active senones.
+void activateSenones(WordAlignment& wordAlignment, ps_decoder_t& decoder) {
+	const auto* alignmentSearch = reinterpret_cast<state_align_search_t*>(wordAlignment.search.get());
+	for (int i = 0; i < alignmentSearch->n_phones; ++i) {
+		acmod_activate_hmm(decoder.acmod, alignmentSearch->hmms + i);
+	}
+}
 
-		// End search
-		error = ps_search_finish(search.get());
-		if (error) return boost::none;
+// Aligns the words with the utterance whose features are in the decoder's acoustic model.
+// Rewinds to the first feature frame instead of computing the features again, so the same
+// utterance can be aligned any number of times.
+// Returns whether the words could be aligned.
+bool alignWords(WordAlignment& wordAlignment, ps_decoder_t& decoder) {
+	// Rewind to the first feature frame of the utterance.
+	// Full-utterance processing keeps all frames, so this doesn't fail unless the
+	// decoder was used in between.
+	acmod_t* acousticModel = decoder.acmod;
+	int error = acmod_rewind(acousticModel);
+	if (error) throw runtime_error("Error rewinding utterance features for alignment.");
+	acousticModel->n_senone_active = 0;
+
+	// Start search
+	ps_search_t* search = wordAlignment.search.get();
+	ps_search_start(search);
+
+	// Process all feature frames
+	while (acousticModel->n_feat_frame > 0) {
+		ps_search_step(search, acousticModel->output_frame);
+		acmod_advance(acousticModel);
 	}
 
-	// Extract phones with timestamps
+	// End search
+	error = ps_search_finish(search);
+	if (error) return false;
+
+	const auto* alignmentSearch = reinterpret_cast<state_align_search_t*>(search);
+	wordAlignment.score = hmm_out_score(alignmentSearch->hmms + alignmentSearch->n_phones - 1);
+	return true;
+}
+
+// Returns the phones of an alignment with timestamps
+Timeline<Phone> getAlignedPhones(ps_alignment_t& alignment, ps_decoder_t& decoder) {
 	char** phoneNames = decoder.dict->mdef->ciname;
 	Timeline<Phone> result;
 	for (
-		ps_alignment_iter_t* it = ps_alignment_phones(alignment.get());
+		ps_alignment_iter_t* it = ps_alignment_phones(&alignment);
 		it;
 		it = ps_alignment_iter_next(it)
 	) {
@@ -231,6 +506,49 @@ optional<Timeline<Phone>> getPhoneAlignment(
 	return result;
 }
 
+// Aligns the words with the utterance that was last recognized by the decoder.
+// Reuses the feature frames the word recognition left in the acoustic model instead of computing
+// them from the audio again.
+optional<Timeline<Phone>> getPhoneAlignment(
+	const vector<s3wid_t>& wordIds,
+	ps_decoder_t& decoder)
+{
+	if (wordIds.empty()) return boost::none;
+
+	WordAlignment wordAlignment = createWordAlignment(wordIds, decoder);
+	if (!alignWords(wordAlignment, decoder)) return boost::none;
+
+	return getAlignedPhones(*wordAlignment.alignment, decoder);
+}
+
+// Returns whether an alignment is implausible, suggesting that its words weren't spoken.
+// Squeezing most phones to their minimum duration means that there are too many words for the
+// audio. A drawn-out phone means that the audio contains speech missing from the words.
+bool isPoorAlignment(ps_alignment_t& alignment, ps_decoder_t& decoder) {
+	const int minPhoneFrameCount = bin_mdef_n_emit_state(decoder.acmod->mdef);
+	const int maxPhoneFrameCount = 50;
+	const s3cipid_t silencePhoneId = bin_mdef_silphone(decoder.acmod->mdef);
+
+	int phoneCount = 0;
+	int minDurationPhoneCount = 0;
+	for (
+		ps_alignment_iter_t* it = ps_alignment_phones(&alignment);
+		it;
+		it = ps_alignment_iter_next(it)
+	) {
+		const ps_alignment_entry_t* phoneEntry = ps_alignment_iter_get(it);
+		if (phoneEntry->id.pid.cipid == silencePhoneId) continue;
+
+		if (phoneEntry->duration > maxPhoneFrameCount) {
+			ps_alignment_iter_free(it);
+			return true;
+		}
+		++phoneCount;
+		if (phoneEntry->duration <= minPhoneFrameCount) ++minDurationPhoneCount;
+	}
+	return minDurationPhoneCount * 2 > phoneCount;
+}
+
 // Some words have multiple pronunciations, one of which results in better animation than the others.
 // This function returns the optimal pronunciation for a select set of these words.
 string fixPronunciation(const string& word) {
@@ -247,33 +565,22 @@ string fixPronunciation(const string& word) {
 	return pair != replacements.end() ? pair->second : word;
 }
 
-static Timeline<Phone> utteranceToPhones(
-	const AudioClip& audioClip,
-	TimeRange utteranceTimeRange,
-	ps_decoder_t& decoder,
-	ProgressSink& utteranceProgressSink
-) {
-	ProgressMerger utteranceProgressMerger(utteranceProgressSink);
-	ProgressSink& wordRecognitionProgressSink =
-		utteranceProgressMerger.addSource("word recognition (PocketSphinx recognizer)", 1.0);
-	ProgressSink& alignmentProgressSink =
-		utteranceProgressMerger.addSource("alignment (PocketSphinx recognizer)", 0.5);
-
-	// Pad time range to give PocketSphinx some breathing room
+// Pads the time range of an utterance to give PocketSphinx some breathing room
+static TimeRange getPaddedTimeRange(const AudioClip& audioClip, TimeRange utteranceTimeRange) {
 	TimeRange paddedTimeRange = utteranceTimeRange;
 	const centiseconds padding(3);
 	paddedTimeRange.grow(padding);
 	paddedTimeRange.trim(audioClip.getTruncatedRange());
+	return paddedTimeRange;
+}
 
-	const unique_ptr<AudioClip> clipSegment = audioClip.clone()
-		| segment(paddedTimeRange)
-		| resample(sphinxSampleRate);
-	const auto audioBuffer = copyTo16bitBuffer(*clipSegment);
-
-	// Get words
-	BoundedTimeline<string> words = recognizeWords(audioBuffer, decoder);
-	wordRecognitionProgressSink.reportProgress(1.0);
-
+// Logs the text and the words of an utterance.
+// The words are timed relative to the padded time range.
+static void logUtteranceWords(
+	const BoundedTimeline<string>& words,
+	TimeRange utteranceTimeRange,
+	TimeRange paddedTimeRange
+) {
 	// Log utterance text
 	string text;
 	for (auto& timedWord : words) {
@@ -295,21 +602,14 @@ static Timeline<Phone> utteranceToPhones(
 		timedWord.getTimeRange().shift(paddedTimeRange.getStart());
 		logTimedEvent("word", timedWord);
 	}
+}
 
-	// Convert word strings to word IDs using dictionary
-	vector<s3wid_t> wordIds;
-	for (const auto& timedWord : words) {
-		const string fixedWord = fixPronunciation(timedWord.getValue());
-		wordIds.push_back(getWordId(fixedWord, *decoder.dict));
-	}
-
-	// Align the words' phones with speech
-#if BOOST_VERSION < 105600 // Support legacy syntax
-#define value_or get_value_or
-#endif
-	Timeline<Phone> utterancePhones = getPhoneAlignment(wordIds, audioBuffer, decoder)
-		.value_or(ContinuousTimeline<Phone>(clipSegment->getTruncatedRange(), Phone::Noise));
-	alignmentProgressSink.reportProgress(1.0);
+// Moves the phones of an utterance from its padded time range to the clip, then marks noise
+static Timeline<Phone> finishUtterancePhones(
+	Timeline<Phone> utterancePhones,
+	TimeRange utteranceTimeRange,
+	TimeRange paddedTimeRange
+) {
 	utterancePhones.shift(paddedTimeRange.getStart());
 
 	// Log raw phones
@@ -331,12 +631,317 @@ static Timeline<Phone> utteranceToPhones(
 	return utterancePhones;
 }
 
+static Timeline<Phone> utteranceToPhones(
+	const AudioClip& audioClip,
+	TimeRange utteranceTimeRange,
+	ps_decoder_t& decoder,
+	ProgressSink& utteranceProgressSink
+) {
+	ProgressMerger utteranceProgressMerger(utteranceProgressSink);
+	ProgressSink& wordRecognitionProgressSink =
+		utteranceProgressMerger.addSource("word recognition (PocketSphinx recognizer)", 1.0);
+	ProgressSink& alignmentProgressSink =
+		utteranceProgressMerger.addSource("alignment (PocketSphinx recognizer)", 0.5);
+
+	const TimeRange paddedTimeRange = getPaddedTimeRange(audioClip, utteranceTimeRange);
+	const UtteranceAudio audioBuffer(audioClip, paddedTimeRange);
+
+	// Get words
+	BoundedTimeline<string> words = recognizeWords(audioBuffer, decoder);
+	wordRecognitionProgressSink.reportProgress(1.0);
+	logUtteranceWords(words, utteranceTimeRange, paddedTimeRange);
+
+	// Convert word strings to word IDs using dictionary
+	vector<s3wid_t> wordIds;
+	for (const auto& timedWord : words) {
+		const string fixedWord = fixPronunciation(timedWord.getValue());
+		wordIds.push_back(getWordId(fixedWord, *decoder.dict));
+	}
+
+	// Grammar searches don't report sentence boundaries. Add them so that the alignment may start
+	// and end with silence.
+	if (!wordIds.empty() && wordIds.front() != dict_startwid(decoder.dict)) {
+		wordIds.insert(wordIds.begin(), dict_startwid(decoder.dict));
+		wordIds.push_back(dict_finishwid(decoder.dict));
+	}
+
+	// Align the words' phones with speech
+#if BOOST_VERSION < 105600 // Support legacy syntax
+#define value_or get_value_or
+#endif
+	Timeline<Phone> utterancePhones = getPhoneAlignment(wordIds, decoder)
+		.value_or(ContinuousTimeline<Phone>(audioBuffer.getTruncatedRange(), Phone::Noise));
+	alignmentProgressSink.reportProgress(1.0);
+
+	return finishUtterancePhones(utterancePhones, utteranceTimeRange, paddedTimeRange);
+}
+
+// Splits the words of a dialog across utterances, assuming a steady speaking rate.
+// Each utterance gets the words whose phones best fill its share of the total speech duration.
+static map<centiseconds, WordRange> splitDialog(
+	const PreparedDialog& dialog,
+	const BoundedTimeline<void>& utterances
+) {
+	// Number of phones before each word boundary
+	vector<int> phoneOffsets { 0 };
+	for (int phoneCount : dialog.phoneCounts) {
+		phoneOffsets.push_back(phoneOffsets.back() + phoneCount);
+	}
+	centiseconds totalDuration(0);
+	for (const auto& utterance : utterances) {
+		totalDuration += utterance.getDuration();
+	}
+
+	map<centiseconds, WordRange> result;
+	centiseconds elapsedDuration(0);
+	size_t wordIndex = 0;
+	for (const auto& utterance : utterances) {
+		elapsedDuration += utterance.getDuration();
+		const double targetPhoneOffset =
+			static_cast<double>(phoneOffsets.back()) * elapsedDuration.count() / totalDuration.count();
+		const size_t begin = wordIndex;
+		while (
+			wordIndex < dialog.words.size()
+			&& std::abs(phoneOffsets[wordIndex + 1] - targetPhoneOffset)
+				<= std::abs(phoneOffsets[wordIndex] - targetPhoneOffset)
+		) {
+			++wordIndex;
+		}
+		result[utterance.getStart()] = { begin, wordIndex };
+	}
+	return result;
+}
+
+// Aligns the dialog words assigned to an utterance without recognizing them first.
+// Each end of the word range may move by one word, so a word that was assigned to the wrong
+// utterance can be skipped or taken from the neighbor. If no alignment is plausible, falls back to
+// word recognition.
+static Timeline<Phone> utteranceToPhonesUsingDialog(
+	const AudioClip& audioClip,
+	TimeRange utteranceTimeRange,
+	const PreparedDialog& dialog,
+	WordRange wordRange,
+	ps_decoder_t& decoder,
+	ProgressSink& utteranceProgressSink
+) {
+	const TimeRange paddedTimeRange = getPaddedTimeRange(audioClip, utteranceTimeRange);
+	const UtteranceAudio audioBuffer(audioClip, paddedTimeRange);
+	computeUtteranceFeatures(audioBuffer, decoder);
+
+	const auto createAlignment = [&](WordRange range) {
+		vector<s3wid_t> wordIds { getWordId("<s>", *decoder.dict) };
+		for (size_t i = range.begin; i < range.end; ++i) {
+			wordIds.push_back(getWordId(dialog.words[i], *decoder.dict));
+		}
+		wordIds.push_back(getWordId("</s>", *decoder.dict));
+		return createWordAlignment(wordIds, decoder);
+	};
+
+	// Each end of the range may move by one word.
+	// Create all candidates up front so that they are aligned with the same active senones.
+	map<WordRange, WordAlignment> candidates;
+	acmod_clear_active(decoder.acmod);
+	for (size_t begin = wordRange.begin > 0 ? wordRange.begin - 1 : 0; begin <= wordRange.begin + 1; ++begin) {
+		for (size_t end = wordRange.end > 0 ? wordRange.end - 1 : 0; end <= wordRange.end + 1; ++end) {
+			if (begin >= end || end > dialog.words.size()) continue;
+
+			WordAlignment candidate = createAlignment({ begin, end });
+			activateSenones(candidate, decoder);
+			candidates.emplace(WordRange { begin, end }, std::move(candidate));
+		}
+	}
+
+	// Find the best range, adjusting the start, then the end
+	WordAlignment* bestAlignment = nullptr;
+	WordRange bestRange = wordRange;
+	std::set<WordRange> triedRanges;
+	const auto tryRange = [&](WordRange range) {
+		const auto candidate = candidates.find(range);
+		if (candidate == candidates.end() || !triedRanges.insert(range).second) return;
+
+		WordAlignment& alignment = candidate->second;
+		if (!alignWords(alignment, decoder)) return;
+		if (!bestAlignment || *alignment.score > *bestAlignment->score) {
+			bestAlignment = &alignment;
+			bestRange = range;
+		}
+	};
+	tryRange(wordRange);
+	const WordRange initialRange = bestRange;
+	tryRange({ initialRange.begin - 1, initialRange.end });
+	tryRange({ initialRange.begin + 1, initialRange.end });
+	const WordRange startAdjustedRange = bestRange;
+	tryRange({ startAdjustedRange.begin, startAdjustedRange.end - 1 });
+	tryRange({ startAdjustedRange.begin, startAdjustedRange.end + 1 });
+
+	if (!bestAlignment || isPoorAlignment(*bestAlignment->alignment, decoder)) {
+		logging::debugFormat(
+			"Dialog doesn't fit utterance at {}. Falling back to recognition.",
+			formatDuration(utteranceTimeRange.getStart()));
+		return utteranceToPhones(audioClip, utteranceTimeRange, decoder, utteranceProgressSink);
+	}
+
+	// Collect words
+	BoundedTimeline<string> words(audioBuffer.getTruncatedRange());
+	for (
+		ps_alignment_iter_t* it = ps_alignment_words(bestAlignment->alignment.get());
+		it;
+		it = ps_alignment_iter_next(it)
+	) {
+		const ps_alignment_entry_t* wordEntry = ps_alignment_iter_get(it);
+		const centiseconds start(wordEntry->start);
+		words.set(start, start + centiseconds(wordEntry->duration), dict_wordstr(decoder.dict, wordEntry->id.wid));
+	}
+	logUtteranceWords(words, utteranceTimeRange, paddedTimeRange);
+
+	Timeline<Phone> utterancePhones = getAlignedPhones(*bestAlignment->alignment, decoder);
+	utteranceProgressSink.reportProgress(1.0);
+
+	return finishUtterancePhones(utterancePhones, utteranceTimeRange, paddedTimeRange);
+}
+
+PocketSphinxRecognizer::PocketSphinxRecognizer(LanguageModelVariant languageModel) :
+	decoderPool([languageModelPath = getDefaultLanguageModelPath(languageModel)] {
+		return createDecoder(languageModelPath);
+	})
+{
+	// The compact model is optional, so report a missing one up front rather than on first use
+	const path languageModelPath = getDefaultLanguageModelPath(languageModel);
+	if (languageModel == LanguageModelVariant::Compact && !std::filesystem::exists(languageModelPath)) {
+		throw runtime_error(fmt::format(
+			"Compact language model not found at {}. Build with RHUBARB_COMPACT_LM to include it.",
+			languageModelPath.u8string()));
+	}
+}
+
 BoundedTimeline<Phone> PocketSphinxRecognizer::recognizePhones(
 	const AudioClip& inputAudioClip,
 	optional<std::string> dialog,
 	int maxThreadCount,
 	ProgressSink& progressSink
 ) const {
+	// Prepare the dialog once rather than for every decoder
+	const shared_ptr<const PreparedDialog> preparedDialog = dialog ? prepareDialog(*dialog) : nullptr;
+	const bool alignDialog = preparedDialog && exactDialog && !preparedDialog->words.empty();
+	RecognitionCostModel& costModel = alignDialog
+		? alignmentCostModel
+		: preparedDialog && dialogGrammar ? grammarCostModel : recognitionCostModel;
 	return ::recognizePhones(
-		inputAudioClip, dialog, &createDecoder, &utteranceToPhones, maxThreadCount, progressSink);
+		inputAudioClip,
+		dialog,
+		[this, preparedDialog](optional<std::string>) { return leaseDecoder(preparedDialog); },
+		[preparedDialog, alignDialog](const BoundedTimeline<void>& utterances) -> utteranceToPhonesFunction {
+			if (!alignDialog) return &utteranceToPhones;
+
+			const auto wordRanges = splitDialog(*preparedDialog, utterances);
+			return [preparedDialog, wordRanges](
+				const AudioClip& audioClip,
+				TimeRange utteranceTimeRange,
+				ps_decoder_t& decoder,
+				ProgressSink& utteranceProgressSink
+			) {
+				return utteranceToPhonesUsingDialog(
+					audioClip,
+					utteranceTimeRange,
+					*preparedDialog,
+					wordRanges.at(utteranceTimeRange.getStart()),
+					decoder,
+					utteranceProgressSink
+				);
+			};
+		},
+		costModel,
+		maxThreadCount,
+		progressSink
+	);
+}
+
+void PocketSphinxRecognizer::prewarm(int decoderCount) {
+	// Acquiring decoders simultaneously forces the pool to create them
+	vector<lambda_unique_ptr<ps_decoder_t>> decoders;
+	for (int i = 0; i < decoderCount; ++i) {
+		decoders.push_back(decoderPool.acquire());
+	}
+}
+
+void PocketSphinxRecognizer::dispose() {
+	decoderPool.clear();
+
+	std::lock_guard<std::mutex> lock(preparedDialogMutex);
+	preparedDialogs.clear();
+}
+
+void PocketSphinxRecognizer::setExactDialog(bool value) {
+	exactDialog = value;
+}
+
+void PocketSphinxRecognizer::setDialogGrammar(bool value) {
+	dialogGrammar = value;
+}
+
+Timeline<Phone> PocketSphinxRecognizer::recognizeUtterancePhones(
+	const AudioClip& audioClip,
+	TimeRange utteranceTimeRange,
+	ps_decoder_t& decoder,
+	ProgressSink& progressSink
+) const {
+	return utteranceToPhones(audioClip, utteranceTimeRange, decoder, progressSink);
+}
+
+shared_ptr<const PreparedDialog> PocketSphinxRecognizer::prepareDialog(const std::string& dialog) const {
+	// Requests often repeat a dialog, e.g. a streaming session and its retries, or several takes of a line.
+	// Prepared dialogs are small, but there is no point in keeping more than the last few.
+	const size_t maxCachedDialogCount = 4;
+	{
+		std::lock_guard<std::mutex> lock(preparedDialogMutex);
+		const auto it = std::find_if(preparedDialogs.begin(), preparedDialogs.end(),
+			[&](const auto& pair) { return pair.first == dialog; });
+		if (it != preparedDialogs.end()) {
+			preparedDialogs.splice(preparedDialogs.begin(), preparedDialogs, it);
+			return it->second;
+		}
+	}
+
+	// Any pooled decoder will do for dictionary lookups
+	const lambda_unique_ptr<ps_decoder_t> decoder = decoderPool.acquire();
+	shared_ptr<const PreparedDialog> preparedDialog = ::prepareDialog(dialog, *decoder);
+
+	std::lock_guard<std::mutex> lock(preparedDialogMutex);
+	// Another thread may have prepared the same dialog in the meantime
+	preparedDialogs.remove_if([&](const auto& pair) { return pair.first == dialog; });
+	preparedDialogs.emplace_front(dialog, preparedDialog);
+	if (preparedDialogs.size() > maxCachedDialogCount) {
+		preparedDialogs.pop_back();
+	}
+	return preparedDialog;
+}
+
+lambda_unique_ptr<ps_decoder_t> PocketSphinxRecognizer::leaseDecoder(optional<std::string> dialog) const {
+	return leaseDecoder(dialog ? prepareDialog(*dialog) : nullptr);
+}
+
+lambda_unique_ptr<ps_decoder_t> PocketSphinxRecognizer::leaseDecoder(
+	shared_ptr<const PreparedDialog> dialog
+) const {
+	lambda_unique_ptr<ps_decoder_t> decoder = decoderPool.acquire();
+	if (!dialog) return decoder;
+
+	const s3wid_t dictionarySize = dict_size(decoder->dict);
+	try {
+		attachDialog(*decoder, *dialog, dialogGrammar);
+	} catch (...) {
+		detachDialog(*decoder, dictionarySize);
+		throw;
+	}
+
+	// Revert to the default search before returning the decoder to the pool.
+	// Until then, the dialog search uses the language model of the prepared dialog.
+	auto returnToPool = decoder.get_deleter();
+	return lambda_unique_ptr<ps_decoder_t>(
+		decoder.release(),
+		[returnToPool, dialog, dictionarySize](ps_decoder_t* decoder) {
+			detachDialog(*decoder, dictionarySize);
+			returnToPool(decoder);
+		}
+	);
 }
@@ -2,13 +2,78 @@
 
 #include "Recognizer.h"
 #include "pocketSphinxTools.h"
+#include "tools/ObjectPool.h"
+#include <list>
 
+struct PreparedDialog;
+
+// Variant of the general language model used when recognizing without a grammar
+enum class LanguageModelVariant {
+	// The full model
+	Full,
+	// A quantized model restricted to words with a known pronunciation. Loads faster and needs less
+	// memory, at the cost of some accuracy. Only available if built with RHUBARB_COMPACT_LM.
+	Compact
+};
+
+// Recognizer based on PocketSphinx.
+// Decoders are expensive to create, so they are kept in a pool that lives as long as the
+// recognizer. Repeated calls to recognizePhones() reuse warm decoders.
 class PocketSphinxRecognizer : public Recognizer {
 public:
+	explicit PocketSphinxRecognizer(LanguageModelVariant languageModel = LanguageModelVariant::Full);
+
 	BoundedTimeline<Phone> recognizePhones(
 		const AudioClip& inputAudioClip,
 		boost::optional<std::string> dialog,
 		int maxThreadCount,
 		ProgressSink& progressSink
 	) const override;
+
+	// Makes sure that at least the specified number of decoders are ready for use
+	void prewarm(int decoderCount);
+
+	// Frees all idle decoders and the cached dialogs
+	void dispose();
+
+	// If set, the dialog passed to recognizePhones() is assumed to be exactly what is said, as with
+	// speech synthesis. Its words are then aligned with the audio directly, without recognizing them
+	// first. Utterances the dialog doesn't fit still go through recognition.
+	void setExactDialog(bool value);
+
+	// If set, the dialog is compiled into a grammar that only allows its words, with optional skips,
+	// repetitions and filler words. Recognition then uses this grammar instead of a language model
+	// biased towards the dialog, which makes for a much smaller search.
+	void setDialogGrammar(bool value);
+
+	// Does the text-side work for a dialog: tokenization, pronunciation guessing for unknown words
+	// and language model statistics. The result can be used by any number of decoders.
+	// Results for the most recently used dialogs are cached, so repeating a dialog doesn't repeat the
+	// work.
+	std::shared_ptr<const PreparedDialog> prepareDialog(const std::string& dialog) const;
+
+	// Takes a decoder from the pool, prepared for the specified dialog.
+	// The decoder returns to the pool when the pointer is destroyed.
+	lambda_unique_ptr<ps_decoder_t> leaseDecoder(boost::optional<std::string> dialog) const;
+	lambda_unique_ptr<ps_decoder_t> leaseDecoder(std::shared_ptr<const PreparedDialog> dialog) const;
+
+	// Recognizes the phones of a single utterance within an audio clip without DC offset
+	Timeline<Phone> recognizeUtterancePhones(
+		const AudioClip& audioClip,
+		TimeRange utteranceTimeRange,
+		ps_decoder_t& decoder,
+		ProgressSink& progressSink
+	) const;
+
+private:
+	mutable ObjectPool<ps_decoder_t, lambda_unique_ptr<ps_decoder_t>> decoderPool;
+	bool exactDialog = false;
+	bool dialogGrammar = false;
+	// Recognition speed differs a lot between modes, so each has its own cost model
+	mutable RecognitionCostModel recognitionCostModel;
+	mutable RecognitionCostModel grammarCostModel;
+	mutable RecognitionCostModel alignmentCostModel;
+	mutable std::mutex preparedDialogMutex;
+	// Prepared dialogs by dialog text, most recently used first
+	mutable std::list<std::pair<std::string, std::shared_ptr<const PreparedDialog>>> preparedDialogs;
 };
@@ -0,0 +1,140 @@
+#include "StreamingPhoneRecognizer.h"
+#include "audio/MemoryAudioClip.h"
+#include "audio/HalfBandDecimator.h"
+#include "audio/DcOffset.h"
+#include "audio/processing.h"
+#include "audio/sampleConversion.h"
+
+using std::vector;
+using std::unique_ptr;
+using std::make_unique;
+using boost::optional;
+
+StreamingPhoneRecognizer::StreamingPhoneRecognizer(
+	const PocketSphinxRecognizer& recognizer,
+	optional<std::string> dialog,
+	PhonesHandler handlePhones
+) :
+	recognizer(recognizer),
+	dialog(std::move(dialog)),
+	handlePhones(std::move(handlePhones))
+{}
+
+void StreamingPhoneRecognizer::addAudio(const float* samples, size_t sampleCount) {
+	addAudio(sampleCount, [&](float* buffer) {
+		std::copy(samples, samples + sampleCount, buffer);
+	});
+}
+
+void StreamingPhoneRecognizer::addAudio(const int16_t* samples, size_t sampleCount) {
+	addAudio(sampleCount, [&](float* buffer) {
+		convertInt16ToFloat(samples, sampleCount, buffer);
+	});
+}
+
+void StreamingPhoneRecognizer::addAudio(size_t sampleCount, const std::function<void(float* buffer)>& writeSamples) {
+	if (finished) throw std::logic_error("Cannot add audio to a finished stream.");
+
+	const size_t previousSampleCount = samples.size();
+	samples.resize(previousSampleCount + sampleCount);
+	try {
+		writeSamples(samples.data() + previousSampleCount);
+	} catch (...) {
+		samples.resize(previousSampleCount);
+		throw;
+	}
+	totalSampleCount += sampleCount;
+
+	// Once the stream is long enough, its DC offset only depends on its beginning
+	if (!dcOffset && totalSampleCount > static_cast<size_t>(dcOffsetWindowSeconds * sphinxSampleRate)) {
+		dcOffset = getDcOffset(*createAudioClip());
+	}
+
+	detectVoiceActivity();
+	recognizeCompletedUtterances();
+	discardUnneededSamples();
+}
+
+void StreamingPhoneRecognizer::finish() {
+	if (finished) return;
+
+	voiceActivityDetector.finish();
+	recognizeCompletedUtterances();
+
+	// Return decoder to pool
+	decoder.reset();
+	samples = {};
+	finished = true;
+}
+
+TimeRange StreamingPhoneRecognizer::getTruncatedRange() const {
+	return TimeRange(0_cs, centiseconds(100 * totalSampleCount / sphinxSampleRate));
+}
+
+// Returns the stream so far. Only the samples that are still kept may be read.
+unique_ptr<AudioClip> StreamingPhoneRecognizer::createAudioClip() const {
+	return make_unique<MemoryAudioClip<float>>(
+		samples.data(), totalSampleCount, sphinxSampleRate, firstSampleIndex);
+}
+
+void StreamingPhoneRecognizer::detectVoiceActivity() {
+	// Only pass complete VAD frames, so that downsampling doesn't straddle two calls
+	constexpr size_t inputFrameSize = sphinxSampleRate / 100;
+	const size_t frameCount = (totalSampleCount - vadSampleCount) / inputFrameSize;
+	if (frameCount == 0) return;
+
+	const size_t sampleCount = frameCount * inputFrameSize;
+	static_assert(
+		sphinxSampleRate == 2 * VoiceActivityDetector::sampleRate,
+		"VAD input is derived by halving the sample rate."
+	);
+	const unique_ptr<AudioClip> audioClip =
+		make_unique<MemoryAudioClip<float>>(
+			samples.data() + (vadSampleCount - firstSampleIndex), sampleCount, sphinxSampleRate)
+		| decimateByTwo();
+	NullProgressSink progressSink;
+	const auto processBuffer = [&](const vector<int16_t>& buffer) {
+		if (buffer.size() < VoiceActivityDetector::frameSize) return;
+
+		voiceActivityDetector.processFrame(buffer.data());
+	};
+	process16bitAudioClip(*audioClip, processBuffer, VoiceActivityDetector::frameSize, progressSink);
+	vadSampleCount += sampleCount;
+}
+
+void StreamingPhoneRecognizer::recognizeCompletedUtterances() {
+	for (const TimeRange& utterance : voiceActivityDetector.takeCompletedUtterances()) {
+		if (!decoder) {
+			decoder = recognizer.leaseDecoder(dialog);
+		}
+
+		// Until the DC offset is fixed, it is estimated from the audio received so far
+		const float offset = dcOffset ? *dcOffset : getDcOffset(*createAudioClip());
+		const unique_ptr<AudioClip> audioClip = createAudioClip() | addDcOffset(-offset);
+		NullProgressSink progressSink;
+		handlePhones(recognizer.recognizeUtterancePhones(*audioClip, utterance, *decoder, progressSink));
+	}
+}
+
+void StreamingPhoneRecognizer::discardUnneededSamples() {
+	// Until the DC offset is fixed, it depends on all samples
+	if (!dcOffset) return;
+
+	// Keep what VAD hasn't processed yet and the open utterance, which may still be recognized.
+	// Recognition reads a little audio around each utterance, so keep some margin.
+	const centiseconds margin = 10_cs;
+	const centiseconds neededStart = std::max(
+		voiceActivityDetector.getOpenUtteranceStart().value_or(voiceActivityDetector.getTime()) - margin,
+		0_cs);
+	const size_t neededSampleIndex = std::min(
+		vadSampleCount,
+		static_cast<size_t>(neededStart.count()) * sphinxSampleRate / 100);
+	if (neededSampleIndex <= firstSampleIndex) return;
+
+	// Discarding moves the kept samples, so only do it once at least as many samples are discarded
+	const size_t unneededSampleCount = neededSampleIndex - firstSampleIndex;
+	if (unneededSampleCount < samples.size() - unneededSampleCount) return;
+
+	samples.erase(samples.begin(), samples.begin() + unneededSampleCount);
+	firstSampleIndex = neededSampleIndex;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "PocketSphinxRecognizer.h"
+#include "audio/voiceActivityDetection.h"
+
+// Recognizes phones in audio that arrives incrementally, e.g. from live speech synthesis.
+// Voice activity detection runs as audio is added. Each utterance is recognized as soon as it is
+// complete, so its phones are reported while later audio is still arriving.
+class StreamingPhoneRecognizer {
+public:
+	using PhonesHandler = std::function<void(const Timeline<Phone>& utterancePhones)>;
+
+	// The recognizer must outlive this object.
+	StreamingPhoneRecognizer(
+		const PocketSphinxRecognizer& recognizer,
+		boost::optional<std::string> dialog,
+		PhonesHandler handlePhones
+	);
+
+	// Appends mono samples at sphinxSampleRate, then recognizes all utterances completed by them
+	void addAudio(const float* samples, size_t sampleCount);
+	void addAudio(const int16_t* samples, size_t sampleCount);
+
+	// Same, but the samples are written to the internal buffer by a function, e.g. straight from JS
+	void addAudio(size_t sampleCount, const std::function<void(float* buffer)>& writeSamples);
+
+	// Recognizes any pending utterance. No audio may be added afterwards.
+	void finish();
+
+	// Returns the time range of the audio added so far
+	TimeRange getTruncatedRange() const;
+
+private:
+	std::unique_ptr<AudioClip> createAudioClip() const;
+	void detectVoiceActivity();
+	void recognizeCompletedUtterances();
+	void discardUnneededSamples();
+
+	const PocketSphinxRecognizer& recognizer;
+	boost::optional<std::string> dialog;
+	PhonesHandler handlePhones;
+	// The samples that may still be needed, starting with sample firstSampleIndex of the stream
+	std::vector<float> samples;
+	size_t firstSampleIndex = 0;
+	// Number of samples added so far
+	size_t totalSampleCount = 0;
+	// DC offset of the stream, once enough audio has been added that it is fixed
+	boost::optional<float> dcOffset;
+	// Number of samples already processed by voice activity detection
+	size_t vadSampleCount = 0;
+	VoiceActivityDetector voiceActivityDetector;
+	// Leased on first use and kept until the stream is finished
+	lambda_unique_ptr<ps_decoder_t> decoder;
+	bool finished = false;
+};
@@ -1,201 +1,209 @@
 #include "languageModels.h"
-#include <boost/range/adaptor/map.hpp>
 #include <vector>
-#include <regex>
-#include <map>
-#include <tuple>
-#include "tools/platformTools.h"
-#include <fstream>
-#include "core/appInfo.h"
+#include <array>
+#include <algorithm>
 #include <cmath>
-#include <gsl_util.h>
 
-using std::string;
-using std::vector;
-using std::regex;
-using std::map;
-using std::tuple;
-using std::get;
-using std::endl;
-using std::filesystem::path;
-
-using Unigram = string;
-using Bigram = tuple<string, string>;
-using Trigram = tuple<string, string, string>;
-
-map<Unigram, int> getUnigramCounts(const vector<string>& words) {
-	map<Unigram, int> unigramCounts;
-	for (const Unigram& unigram : words) {
-		++unigramCounts[unigram];
-	}
-	return unigramCounts;
+extern "C" {
+#include <ngram_model_trie.h>
 }
 
-map<Bigram, int> getBigramCounts(const vector<string>& words) {
-	map<Bigram, int> bigramCounts;
-	for (auto it = words.begin(); it < words.end() - 1; ++it) {
-		++bigramCounts[Bigram(*it, *(it + 1))];
+using std::string;
+using std::vector;
+using std::array;
+
+// An n-gram of word IDs in text order
+template<size_t order>
+struct Ngram {
+	array<uint32, order> words;
+	int count;
+	double probability;
+	// 1 minus the probabilities of all words that have been seen after this n-gram
+	double backoffDenominator;
+};
+
+// Returns the n-grams of a word sequence with their counts, sorted by words
+template<size_t order>
+vector<Ngram<order>> getNgrams(const vector<uint32>& wordIds) {
+	vector<array<uint32, order>> occurrences;
+	for (size_t i = 0; i + order <= wordIds.size(); ++i) {
+		array<uint32, order> words;
+		std::copy_n(wordIds.begin() + i, order, words.begin());
+		occurrences.push_back(words);
 	}
-	return bigramCounts;
-}
+	std::sort(occurrences.begin(), occurrences.end());
 
-map<Trigram, int> getTrigramCounts(const vector<string>& words) {
-	map<Trigram, int> trigramCounts;
-	if (words.size() >= 3) {
-		for (auto it = words.begin(); it < words.end() - 2; ++it) {
-			++trigramCounts[Trigram(*it, *(it + 1), *(it + 2))];
+	vector<Ngram<order>> ngrams;
+	for (const auto& words : occurrences) {
+		if (ngrams.empty() || ngrams.back().words != words) {
+			ngrams.push_back({ words, 0, 0.0, 1.0 });
 		}
+		++ngrams.back().count;
 	}
-	return trigramCounts;
+	return ngrams;
 }
 
-map<Unigram, double> getUnigramProbabilities(
-	const vector<string>& words,
-	const map<Unigram, int>& unigramCounts,
-	const double deflator
-) {
-	map<Unigram, double> unigramProbabilities;
-	for (const auto& pair : unigramCounts) {
-		const Unigram& unigram = get<0>(pair);
-		const int unigramCount = get<1>(pair);
-		unigramProbabilities[unigram] = double(unigramCount) / words.size() * deflator;
-	}
-	return unigramProbabilities;
+// Returns the n-gram consisting of the specified words, which must exist
+template<size_t order>
+Ngram<order>& findNgram(vector<Ngram<order>>& ngrams, const array<uint32, order>& words) {
+	return *std::lower_bound(ngrams.begin(), ngrams.end(), words,
+		[](const Ngram<order>& ngram, const array<uint32, order>& words) { return ngram.words < words; });
 }
 
-map<Bigram, double> getBigramProbabilities(
-	const map<Unigram, int>& unigramCounts,
-	const map<Bigram, int>& bigramCounts,
-	const double deflator
-) {
-	map<Bigram, double> bigramProbabilities;
-	for (const auto& pair : bigramCounts) {
-		Bigram bigram = get<0>(pair);
-		const int bigramCount = get<1>(pair);
-		const int unigramPrefixCount = unigramCounts.at(get<0>(bigram));
-		bigramProbabilities[bigram] = double(bigramCount) / unigramPrefixCount * deflator;
+template<size_t order>
+NgramTable toNgramTable(const vector<Ngram<order>>& ngrams, double discountMass) {
+	NgramTable result { order };
+	result.words.resize(ngrams.size() * order);
+	for (size_t i = 0; i < ngrams.size(); ++i) {
+		std::reverse_copy(ngrams[i].words.begin(), ngrams[i].words.end(), &result.words[i * order]);
+		result.probabilities.push_back(static_cast<float32>(log10(ngrams[i].probability)));
+		result.backoffWeights.push_back(
+			static_cast<float32>(log10(discountMass / ngrams[i].backoffDenominator)));
 	}
-	return bigramProbabilities;
+	return result;
 }
 
-map<Trigram, double> getTrigramProbabilities(
-	const map<Bigram, int>& bigramCounts,
-	const map<Trigram, int>& trigramCounts,
-	const double deflator
-) {
-	map<Trigram, double> trigramProbabilities;
-	for (const auto& pair : trigramCounts) {
-		Trigram trigram = get<0>(pair);
-		const int trigramCount = get<1>(pair);
-		const int bigramPrefixCount = bigramCounts.at(Bigram(get<0>(trigram), get<1>(trigram)));
-		trigramProbabilities[trigram] = double(trigramCount) / bigramPrefixCount * deflator;
+// Returns the n-grams of a table in the format sphinxbase reads them from an ARPA file.
+// The result refers to the words of the table.
+vector<ngram_raw_t> toRawNgrams(const NgramTable& table) {
+	vector<ngram_raw_t> result(table.probabilities.size());
+	for (size_t i = 0; i < result.size(); ++i) {
+		// The trie only reads the words
+		result[i].words = const_cast<uint32*>(&table.words[i * table.order]);
+		result[i].prob = table.probabilities[i];
+		result[i].backoff = table.backoffWeights[i];
 	}
-	return trigramProbabilities;
+	return result;
 }
 
-map<Unigram, double> getUnigramBackoffWeights(
-	const map<Unigram, int>& unigramCounts,
-	const map<Unigram, double>& unigramProbabilities,
-	const map<Bigram, int>& bigramCounts,
-	const double discountMass)
-{
-	map<Unigram, double> unigramBackoffWeights;
-	for (const Unigram& unigram : unigramCounts | boost::adaptors::map_keys) {
-		double denominator = 1;
-		for (const Bigram& bigram : bigramCounts | boost::adaptors::map_keys) {
-			if (get<0>(bigram) == unigram) {
-				denominator -= unigramProbabilities.at(get<1>(bigram));
-			}
-		}
-		unigramBackoffWeights[unigram] = discountMass / denominator;
-	}
-	return unigramBackoffWeights;
-}
+TrigramModel createTrigramModel(const vector<string>& words) {
+	const double discountMass = 0.5;
+	const double deflator = 1.0 - discountMass;
 
-map<Bigram, double> getBigramBackoffWeights(
-	const map<Bigram, int>& bigramCounts,
-	const map<Bigram, double>& bigramProbabilities,
-	const map<Trigram, int>& trigramCounts,
-	const double discountMass)
-{
-	map<Bigram, double> bigramBackoffWeights;
-	for (const Bigram& bigram : bigramCounts | boost::adaptors::map_keys) {
-		double denominator = 1;
-		for (const Trigram& trigram : trigramCounts | boost::adaptors::map_keys) {
-			if (Bigram(get<0>(trigram), get<1>(trigram)) == bigram) {
-				denominator -= bigramProbabilities.at(Bigram(get<1>(trigram), get<2>(trigram)));
-			}
-		}
-		bigramBackoffWeights[bigram] = discountMass / denominator;
+	TrigramModel model;
+
+	// Assign word IDs in alphabetical order
+	model.vocabulary = words;
+	std::sort(model.vocabulary.begin(), model.vocabulary.end());
+	model.vocabulary.erase(
+		std::unique(model.vocabulary.begin(), model.vocabulary.end()), model.vocabulary.end());
+	vector<uint32> wordIds;
+	wordIds.reserve(words.size());
+	for (const string& word : words) {
+		wordIds.push_back(static_cast<uint32>(
+			std::lower_bound(model.vocabulary.begin(), model.vocabulary.end(), word)
+				- model.vocabulary.begin()));
 	}
-	return bigramBackoffWeights;
-}
 
-void createLanguageModelFile(const vector<string>& words, const path& filePath) {
-	const double discountMass = 0.5;
-	const double deflator = 1.0 - discountMass;
+	// Since all n-grams are sorted, the n-grams starting with a given (n-1)-gram form a
+	// contiguous range, and each order takes a single pass.
+	vector<Ngram<1>> unigrams = getNgrams<1>(wordIds);
+	vector<Ngram<2>> bigrams = getNgrams<2>(wordIds);
+	vector<Ngram<3>> trigrams = getNgrams<3>(wordIds);
 
-	map<Unigram, int> unigramCounts = getUnigramCounts(words);
-	map<Bigram, int> bigramCounts = getBigramCounts(words);
-	map<Trigram, int> trigramCounts = getTrigramCounts(words);
-
-	map<Unigram, double> unigramProbabilities =
-		getUnigramProbabilities(words, unigramCounts, deflator);
-	map<Bigram, double> bigramProbabilities =
-		getBigramProbabilities(unigramCounts, bigramCounts, deflator);
-	map<Trigram, double> trigramProbabilities =
-		getTrigramProbabilities(bigramCounts, trigramCounts, deflator);
-
-	map<Unigram, double> unigramBackoffWeights =
-		getUnigramBackoffWeights(unigramCounts, unigramProbabilities, bigramCounts, discountMass);
-	map<Bigram, double> bigramBackoffWeights =
-		getBigramBackoffWeights(bigramCounts, bigramProbabilities, trigramCounts, discountMass);
-
-	std::ofstream file(filePath);
-	file << "Generated by " << appName << " " << appVersion << endl << endl;
-
-	file << "\\data\\" << endl;
-	file << "ngram 1=" << unigramCounts.size() << endl;
-	file << "ngram 2=" << bigramCounts.size() << endl;
-	file << "ngram 3=" << trigramCounts.size() << endl << endl;
-
-	file.setf(std::ios::fixed, std::ios::floatfield);
-	file.precision(4);
-	file << "\\1-grams:" << endl;
-	for (const Unigram& unigram : unigramCounts | boost::adaptors::map_keys) {
-		file << log10(unigramProbabilities.at(unigram))
-			<< " " << unigram
-			<< " " << log10(unigramBackoffWeights.at(unigram)) << endl;
+	for (Ngram<1>& unigram : unigrams) {
+		unigram.probability = double(unigram.count) / words.size() * deflator;
 	}
-	file << endl;
 
-	file << "\\2-grams:" << endl;
-	for (const Bigram& bigram : bigramCounts | boost::adaptors::map_keys) {
-		file << log10(bigramProbabilities.at(bigram))
-			<< " " << get<0>(bigram) << " " << get<1>(bigram)
-			<< " " << log10(bigramBackoffWeights.at(bigram)) << endl;
+	for (Ngram<2>& bigram : bigrams) {
+		Ngram<1>& prefix = unigrams[bigram.words[0]];
+		bigram.probability = double(bigram.count) / prefix.count * deflator;
+		prefix.backoffDenominator -= unigrams[bigram.words[1]].probability;
 	}
-	file << endl;
 
-	file << "\\3-grams:" << endl;
-	for (const Trigram& trigram : trigramCounts | boost::adaptors::map_keys) {
-		file << log10(trigramProbabilities.at(trigram))
-			<< " " << get<0>(trigram) << " " << get<1>(trigram) << " " << get<2>(trigram) << endl;
+	auto prefix = bigrams.begin();
+	for (Ngram<3>& trigram : trigrams) {
+		while (prefix->words[0] != trigram.words[0] || prefix->words[1] != trigram.words[1]) {
+			++prefix;
+		}
+		trigram.probability = double(trigram.count) / prefix->count * deflator;
+		prefix->backoffDenominator -=
+			findNgram(bigrams, { trigram.words[1], trigram.words[2] }).probability;
 	}
-	file << endl;
 
-	file << "\\end\\" << endl;
+	for (const Ngram<1>& unigram : unigrams) {
+		model.unigramProbabilities.push_back(static_cast<float32>(log10(unigram.probability)));
+		model.unigramBackoffWeights.push_back(
+			static_cast<float32>(log10(discountMass / unigram.backoffDenominator)));
+	}
+	model.bigrams = toNgramTable(bigrams, discountMass);
+	model.trigrams = toNgramTable(trigrams, discountMass);
+	return model;
 }
 
 lambda_unique_ptr<ngram_model_t> createLanguageModel(
-	const vector<string>& words,
+	const TrigramModel& model,
 	ps_decoder_t& decoder
 ) {
-	path tempFilePath = getTempFilePath();
-	createLanguageModelFile(words, tempFilePath);
-	auto deleteTempFile = gsl::finally([&]() { std::filesystem::remove(tempFilePath); });
-
+	// Build the model directly, without an ARPA file in between
+	vector<const char*> wordStrings;
+	for (const string& word : model.vocabulary) {
+		wordStrings.push_back(word.c_str());
+	}
+	vector<ngram_raw_t> rawBigrams = toRawNgrams(model.bigrams);
+	vector<ngram_raw_t> rawTrigrams = toRawNgrams(model.trigrams);
+
+	const int order = 3;
+	array<uint32, order> counts {
+		static_cast<uint32>(model.vocabulary.size()),
+		static_cast<uint32>(rawBigrams.size()),
+		static_cast<uint32>(rawTrigrams.size())
+	};
+	array<ngram_raw_t*, order - 1> rawNgrams { rawBigrams.data(), rawTrigrams.data() };
 	return lambda_unique_ptr<ngram_model_t>(
-		ngram_model_read(decoder.config, tempFilePath.u8string().c_str(), NGRAM_ARPA, decoder.lmath),
+		ngram_model_trie_build(
+			decoder.config,
+			decoder.lmath,
+			order,
+			counts.data(),
+			wordStrings.data(),
+			model.unigramProbabilities.data(),
+			model.unigramBackoffWeights.data(),
+			rawNgrams.data()
+		),
 		[](ngram_model_t* lm) { ngram_model_free(lm); });
 }
+
+lambda_unique_ptr<fsg_model_t> createDialogGrammar(const vector<string>& words, ps_decoder_t& decoder) {
+	// State i means that the first i words have been said.
+	// Dedicated start and final states connect to all of them via null transitions.
+	const int wordCount = static_cast<int>(words.size());
+	const int startState = wordCount + 1;
+	const int finalState = wordCount + 2;
+	const float32 languageWeight = cmd_ln_float32_r(decoder.config, "-lw");
+	lambda_unique_ptr<fsg_model_t> grammar(
+		fsg_model_init("dialog", decoder.lmath, languageWeight, wordCount + 3),
+		[](fsg_model_t* grammar) { fsg_model_free(grammar); });
+	if (!grammar) return grammar;
+	grammar->start_state = startState;
+	grammar->final_state = finalState;
+
+	const auto toLogProbability = [&](double probability) {
+		return static_cast<int32>(logmath_log(decoder.lmath, probability) * languageWeight);
+	};
+	const int32 nextWordLogProbability = toLogProbability(0.8);
+	const int32 skipLogProbability = toLogProbability(0.1);
+	const int32 repeatLogProbability = toLogProbability(0.1);
+	for (int i = 0; i < wordCount; ++i) {
+		const int32 wordId = fsg_model_word_add(grammar.get(), words[i].c_str());
+		fsg_model_trans_add(grammar.get(), i, i + 1, nextWordLogProbability, wordId);
+		// Skip the preceding word
+		if (i > 0) {
+			fsg_model_trans_add(grammar.get(), i - 1, i + 1, skipLogProbability, wordId);
+		}
+		// Repeat the word
+		fsg_model_trans_add(grammar.get(), i + 1, i + 1, repeatLogProbability, wordId);
+	}
+
+	// Filler words are added by the search
+	for (int state = 0; state <= wordCount; ++state) {
+		fsg_model_null_trans_add(grammar.get(), startState, state, 0);
+		fsg_model_null_trans_add(grammar.get(), state, finalState, 0);
+	}
+
+	// The search expects the transitive closure of null transitions.
+	// Chaining them only yields a direct transition from start to final state.
+	glist_free(fsg_model_null_trans_closure(grammar.get(), nullptr));
+
+	return grammar;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <string>
 #include "tools/tools.h"
 
 extern "C" {
@@ -8,7 +9,35 @@ extern "C" {
 #include <ngram_search.h>
 }
 
+// N-grams of one order, in the form sphinxbase builds its language model trie from
+struct NgramTable {
+	int order;
+	std::vector<uint32> words;	// order word IDs per n-gram, last word first
+	std::vector<float32> probabilities;	// log10
+	std::vector<float32> backoffWeights;	// log10
+};
+
+// Trigram language model of a word sequence, independent of any decoder.
+// Computing it is the expensive part; building it for a decoder is cheap.
+struct TrigramModel {
+	std::vector<std::string> vocabulary;	// Word i of the model
+	std::vector<float32> unigramProbabilities;	// log10
+	std::vector<float32> unigramBackoffWeights;	// log10
+	NgramTable bigrams;
+	NgramTable trigrams;
+};
+
+TrigramModel createTrigramModel(const std::vector<std::string>& words);
+
 lambda_unique_ptr<ngram_model_t> createLanguageModel(
+	const TrigramModel& model,
+	ps_decoder_t& decoder
+);
+
+// Finite-state grammar over the words of a dialog.
+// An utterance may start and end at any word. Within it, words may be skipped or repeated.
+// All words must be in the decoder's dictionary.
+lambda_unique_ptr<fsg_model_t> createDialogGrammar(
 	const std::vector<std::string>& words,
 	ps_decoder_t& decoder
 );
@@ -2,7 +2,15 @@
 
 #include "tools/platformTools.h"
 #include <regex>
-#include "audio/DcOffset.h"
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <gsl_util.h>
+#include "audio/AudioSegment.h"
+#include "audio/SampleRateConverter.h"
+#include "audio/processing.h"
 #include "audio/voiceActivityDetection.h"
 #include "tools/parallel.h"
 #include "tools/ObjectPool.h"
@@ -82,33 +90,136 @@ void redirectPocketSphinxOutput() {
 	redirected = true;
 }
 
+double RecognitionCostModel::predictSeconds(centiseconds duration) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	const Fit fit = getFit();
+	return fit.overheadSeconds + fit.realTimeFactor * toSeconds(duration);
+}
+
+void RecognitionCostModel::addObservation(centiseconds duration, double seconds) {
+	std::lock_guard<std::mutex> lock(mutex);
+	const double x = toSeconds(duration);
+	++count;
+	sumX += x;
+	sumY += seconds;
+	sumXX += x * x;
+	sumXY += x * seconds;
+}
+
+double RecognitionCostModel::toSeconds(centiseconds duration) {
+	return duration.count() / 100.0;
+}
+
+RecognitionCostModel::Fit RecognitionCostModel::getFit() const {
+	// Until there are enough observations, assume typical values for the full language model
+	const Fit defaultFit { 0.05, 0.5 };
+	const double denominator = count * sumXX - sumX * sumX;
+	if (count < 8 || denominator <= 0) return defaultFit;
+
+	const double realTimeFactor = (count * sumXY - sumX * sumY) / denominator;
+	const double overheadSeconds = (sumY - realTimeFactor * sumX) / count;
+	if (realTimeFactor <= 0 || overheadSeconds < 0) {
+		// Noisy observations; fall back to a plain average
+		return { 0.0, sumX > 0 ? sumY / sumX : defaultFit.realTimeFactor };
+	}
+	return { overheadSeconds, realTimeFactor };
+}
+
+// Joins the phones on both sides of a cut through an utterance.
+// Each part is recognized as if it were a complete utterance, so a phone spanning the cut is split
+// in two, and the phones next to the cut may be shortened by a silence that isn't there.
+static void stitchPhonesAtCut(BoundedTimeline<Phone>& phones, centiseconds cut) {
+	// Gaps at least this long are marked as noise, so anything shorter is only a silence
+	const centiseconds maxGap = 12_cs;
+
+	const auto left = phones.find(cut, FindMode::SearchLeft);
+	const auto right = phones.find(cut, FindMode::SearchRight);
+	if (left == phones.end() || right == phones.end() || left == right) return;
+	if (left->getEnd() > cut || right->getStart() < cut) return;
+	if (right->getStart() - left->getEnd() >= maxGap) return;
+
+	const Timed<Phone> leftPhone = *left;
+	const Timed<Phone> rightPhone = *right;
+	if (leftPhone.getValue() == rightPhone.getValue()) {
+		phones.set(leftPhone.getStart(), rightPhone.getEnd(), leftPhone.getValue());
+	} else {
+		phones.set(leftPhone.getStart(), cut, leftPhone.getValue());
+		phones.set(cut, rightPhone.getEnd(), rightPhone.getValue());
+	}
+}
+
 BoundedTimeline<Phone> recognizePhones(
 	const AudioClip& inputAudioClip,
 	optional<std::string> dialog,
 	decoderFactory createDecoder,
-	utteranceToPhonesFunction utteranceToPhones,
+	utteranceToPhonesFactory createUtteranceToPhones,
+	RecognitionCostModel& costModel,
 	int maxThreadCount,
 	ProgressSink& progressSink
 ) {
 	ProgressMerger totalProgressMerger(progressSink);
+	ProgressSink& preprocessingProgressSink =
+		totalProgressMerger.addSource("preprocessing (PocketSphinx tools)", 0.5);
 	ProgressSink& voiceActivationProgressSink =
 		totalProgressMerger.addSource("VAD (PocketSphinx tools)", 1.0);
 	ProgressSink& dialogProgressSink =
 		totalProgressMerger.addSource("recognition (PocketSphinx tools)", 15.0);
 
-	// Make sure audio stream has no DC offset
-	const unique_ptr<AudioClip> audioClip = inputAudioClip.clone() | removeDcOffset();
+	// Remove the DC offset and resample only once. VAD and all utterances read from the result.
+	const unique_ptr<AudioClip> audioClip =
+		preprocessAudio(inputAudioClip, sphinxSampleRate, preprocessingProgressSink);
 
 	// Split audio into utterances
-	JoiningBoundedTimeline<void> utterances;
+	VoiceActivity voiceActivity;
 	try {
-		utterances = detectVoiceActivity(*audioClip, voiceActivationProgressSink);
+		voiceActivity = detectVoiceActivity(*audioClip, voiceActivationProgressSink);
 	} catch (...) {
 		std::throw_with_nested(runtime_error("Error detecting segments of speech."));
 	}
 
+	// Determine how many parallel threads to use
+	int threadCount = std::min(
+		maxThreadCount,
+		// Don't waste time creating additional threads (and decoders!) if the recording is short
+		static_cast<int>(
+			duration_cast<std::chrono::seconds>(audioClip->getTruncatedRange().getDuration()).count() / 5
+		)
+	);
+	if (threadCount < 1) {
+		threadCount = 1;
+	}
+
+	// A long utterance keeps one thread busy after the others are done, so split it into parts.
+	// The cuts only depend on the audio, so that the result doesn't depend on the thread count.
+	const centiseconds maxUtteranceDuration = 1500_cs;
+	const BoundedTimeline<void> utterances = splitLongUtterances(voiceActivity, maxUtteranceDuration);
+	// Don't use more threads than there are utterances to be processed
+	threadCount = std::max(1, std::min(threadCount, static_cast<int>(utterances.size())));
+
+	// Start with the utterances that take longest, so that the short ones fill the gaps at the end
+	vector<Timed<void>> orderedUtterances(utterances.begin(), utterances.end());
+	if (threadCount > 1) {
+		std::stable_sort(
+			orderedUtterances.begin(),
+			orderedUtterances.end(),
+			[&](const Timed<void>& a, const Timed<void>& b) {
+				return costModel.predictSeconds(a.getDuration()) > costModel.predictSeconds(b.getDuration());
+			}
+		);
+	}
+
+	// Utterances detected by VAD are never adjacent, so adjacent utterances are parts of a split one
+	std::set<centiseconds> cuts;
+	for (auto it = utterances.begin(); it != utterances.end() && std::next(it) != utterances.end(); ++it) {
+		if (it->getEnd() == std::next(it)->getStart()) {
+			cuts.insert(it->getEnd());
+		}
+	}
+
 	redirectPocketSphinxOutput();
 
+	const utteranceToPhonesFunction utteranceToPhones = createUtteranceToPhones(utterances);
+
 	// Prepare pool of decoders
 	ObjectPool<ps_decoder_t, lambda_unique_ptr<ps_decoder_t>> decoderPool(
 		[&] { return createDecoder(dialog); });
@@ -118,12 +229,25 @@ BoundedTimeline<Phone> recognizePhones(
 	const auto processUtterance = [&](Timed<void> timedUtterance, ProgressSink& utteranceProgressSink) {
 		// Detect phones for utterance
 		const auto decoder = decoderPool.acquire();
+		const auto startTime = std::chrono::steady_clock::now();
 		Timeline<Phone> utterancePhones = utteranceToPhones(
 			*audioClip,
 			timedUtterance.getTimeRange(),
 			*decoder,
 			utteranceProgressSink
 		);
+		costModel.addObservation(
+			timedUtterance.getDuration(),
+			std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count());
+
+		// Phones padded beyond a cut belong to the neighboring part
+		const TimeRange phonesRange = utterancePhones.getRange();
+		if (cuts.count(timedUtterance.getStart()) && phonesRange.getStart() < timedUtterance.getStart()) {
+			utterancePhones.clear(phonesRange.getStart(), timedUtterance.getStart());
+		}
+		if (cuts.count(timedUtterance.getEnd()) && phonesRange.getEnd() > timedUtterance.getEnd()) {
+			utterancePhones.clear(timedUtterance.getEnd(), phonesRange.getEnd());
+		}
 
 		// Copy phones to result timeline
 		std::lock_guard<std::mutex> lock(resultMutex);
@@ -138,24 +262,11 @@ BoundedTimeline<Phone> recognizePhones(
 
 	// Perform speech recognition
 	try {
-		// Determine how many parallel threads to use
-		int threadCount = std::min({
-			maxThreadCount,
-			// Don't use more threads than there are utterances to be processed
-			static_cast<int>(utterances.size()),
-			// Don't waste time creating additional threads (and decoders!) if the recording is short
-			static_cast<int>(
-				duration_cast<std::chrono::seconds>(audioClip->getTruncatedRange().getDuration()).count() / 5
-			)
-		});
-		if (threadCount < 1) {
-			threadCount = 1;
-		}
 		logging::debugFormat("Speech recognition using {} threads -- start", threadCount);
 		runParallel(
 			"speech recognition (PocketSphinx tools)",
 			processUtterance,
-			utterances,
+			orderedUtterances,
 			threadCount,
 			dialogProgressSink,
 			getUtteranceProgressWeight
@@ -165,6 +276,10 @@ BoundedTimeline<Phone> recognizePhones(
 		std::throw_with_nested(runtime_error("Error performing speech recognition via PocketSphinx tools."));
 	}
 
+	for (centiseconds cut : cuts) {
+		stitchPhonesAtCut(phones, cut);
+	}
+
 	return phones;
 }
 
@@ -195,7 +310,25 @@ JoiningTimeline<void> getNoiseSounds(TimeRange utteranceTimeRange, const Timelin
 	return noiseSounds;
 }
 
-BoundedTimeline<string> recognizeWords(const vector<int16_t>& audioBuffer, ps_decoder_t& decoder) {
+UtteranceAudio::UtteranceAudio(const AudioClip& audioClip, TimeRange timeRange) {
+	const unique_ptr<AudioClip> clipSegment = audioClip.clone()
+		| segment(timeRange)
+		| resample(sphinxSampleRate);
+	sampleCount = static_cast<size_t>(clipSegment->size());
+
+	// 16-bit audio at the right sample rate, such as preprocessed audio, is used in place
+	samples = clipSegment->getInt16Samples();
+	if (!samples) {
+		buffer = copyTo16bitBuffer(*clipSegment);
+		samples = buffer.data();
+	}
+}
+
+TimeRange UtteranceAudio::getTruncatedRange() const {
+	return TimeRange(0_cs, centiseconds(100 * sampleCount / sphinxSampleRate));
+}
+
+BoundedTimeline<string> recognizeWords(const UtteranceAudio& audioBuffer, ps_decoder_t& decoder) {
 	// Restart timing at 0
 	ps_start_stream(&decoder);
 
@@ -227,7 +360,10 @@ BoundedTimeline<string> recognizeWords(const vector<int16_t>& audioBuffer, ps_de
 		// Not every utterance does contain speech, however. In this case, we exit early to prevent
 		// the log output.
 		// We *don't* to that in phonetic mode because here, the same code would omit valid phones.
-		const bool noWordsRecognized = reinterpret_cast<ngram_search_t*>(decoder.search)->bpidx == 0;
+		// Grammar searches don't have this problem.
+		const bool isNgramSearch = strcmp(ps_search_type(decoder.search), PS_SEARCH_TYPE_NGRAM) == 0;
+		const bool noWordsRecognized =
+			isNgramSearch && reinterpret_cast<ngram_search_t*>(decoder.search)->bpidx == 0;
 		if (noWordsRecognized) {
 			return result;
 		}
@@ -236,6 +372,9 @@ BoundedTimeline<string> recognizeWords(const vector<int16_t>& audioBuffer, ps_de
 	// Collect words
 	for (ps_seg_t* it = ps_seg_iter(&decoder); it; it = ps_seg_next(it)) {
 		const char* word = ps_seg_word(it);
+		// Grammar searches report null transitions as segments with a placeholder word
+		if (strcmp(word, "(NULL)") == 0) continue;
+
 		int firstFrame, lastFrame;
 		ps_seg_frames(it, &firstFrame, &lastFrame);
 		result.set(centiseconds(firstFrame), centiseconds(lastFrame + 1), word);
@@ -243,3 +382,19 @@ BoundedTimeline<string> recognizeWords(const vector<int16_t>& audioBuffer, ps_de
 
 	return result;
 }
+
+void computeUtteranceFeatures(const UtteranceAudio& audioBuffer, ps_decoder_t& decoder) {
+	acmod_t* acousticModel = decoder.acmod;
+	// Restart timing at 0 and forget the noise estimate of the decoder's previous utterance
+	acmod_start_stream(acousticModel);
+	int error = acmod_start_utt(acousticModel);
+	if (error) throw runtime_error("Error starting utterance processing for feature extraction.");
+
+	// Process entire audio clip
+	const int16* nextSample = audioBuffer.data();
+	size_t remainingSamples = audioBuffer.size();
+	const bool fullUtterance = true;
+	const int frameCount = acmod_process_raw(acousticModel, &nextSample, &remainingSamples, fullUtterance);
+	acmod_end_utt(acousticModel);
+	if (frameCount < 0) throw runtime_error("Error computing features of raw audio data.");
+}
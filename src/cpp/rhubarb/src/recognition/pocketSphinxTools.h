@@ -5,6 +5,7 @@
 #include "audio/AudioClip.h"
 #include "tools/progress.h"
 #include <filesystem>
+#include <mutex>
 
 extern "C" {
 #include <pocketsphinx.h>
@@ -21,22 +22,91 @@ typedef std::function<Timeline<Phone>(
 	ProgressSink& utteranceProgressSink
 )> utteranceToPhonesFunction;
 
+// Creates the function that recognizes each utterance, once all utterances are known.
+// Long utterances may have been split into adjacent parts, which count as separate utterances.
+typedef std::function<utteranceToPhonesFunction(
+	const BoundedTimeline<void>& utterances
+)> utteranceToPhonesFactory;
+
+// Predicts how long recognizing an utterance takes, based on the utterances recognized so far.
+// The time is modeled as a fixed overhead per utterance plus a real-time factor times the duration,
+// fitted by least squares. The prediction only decides the order in which utterances are processed,
+// never the result.
+class RecognitionCostModel {
+public:
+	double predictSeconds(centiseconds duration) const;
+	void addObservation(centiseconds duration, double seconds);
+
+private:
+	struct Fit {
+		double overheadSeconds;
+		double realTimeFactor;
+	};
+
+	static double toSeconds(centiseconds duration);
+	Fit getFit() const;
+
+	mutable std::mutex mutex;
+	int count = 0;
+	double sumX = 0;
+	double sumY = 0;
+	double sumXX = 0;
+	double sumXY = 0;
+};
+
 BoundedTimeline<Phone> recognizePhones(
 	const AudioClip& inputAudioClip,
 	boost::optional<std::string> dialog,
 	decoderFactory createDecoder,
-	utteranceToPhonesFunction utteranceToPhones,
+	utteranceToPhonesFactory createUtteranceToPhones,
+	RecognitionCostModel& costModel,
 	int maxThreadCount,
 	ProgressSink& progressSink
 );
 
 constexpr int sphinxSampleRate = 16000;
 
+void redirectPocketSphinxOutput();
+
 const std::filesystem::path& getSphinxModelDirectory();
 
 JoiningTimeline<void> getNoiseSounds(TimeRange utteranceTimeRange, const Timeline<Phone>& phones);
 
+// The 16-bit samples of part of an audio clip, at sphinxSampleRate.
+// If the clip stores 16-bit samples at that rate, they are used in place, so they must outlive this
+// object. Other audio is converted.
+class UtteranceAudio {
+public:
+	UtteranceAudio(const AudioClip& audioClip, TimeRange timeRange);
+	UtteranceAudio(const UtteranceAudio&) = delete;
+	UtteranceAudio& operator=(const UtteranceAudio&) = delete;
+
+	const int16_t* data() const {
+		return samples;
+	}
+
+	size_t size() const {
+		return sampleCount;
+	}
+
+	TimeRange getTruncatedRange() const;
+
+private:
+	std::vector<int16_t> buffer;
+	const int16_t* samples;
+	size_t sampleCount;
+};
+
+// Recognizes the words of a single utterance.
+// Its feature frames stay in the decoder's acoustic model until the next utterance starts.
 BoundedTimeline<std::string> recognizeWords(
-	const std::vector<int16_t>& audioBuffer,
+	const UtteranceAudio& audioBuffer,
+	ps_decoder_t& decoder
+);
+
+// Computes the feature frames of a single utterance without recognizing it.
+// They stay in the decoder's acoustic model until the next utterance starts.
+void computeUtteranceFeatures(
+	const UtteranceAudio& audioBuffer,
 	ps_decoder_t& decoder
 );
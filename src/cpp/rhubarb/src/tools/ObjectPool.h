@@ -38,6 +38,12 @@ public:
 		return pool.size();
 	}
 
+	// Destroys all idle objects. Objects currently acquired are returned to the pool as usual.
+	void clear() {
+		std::lock_guard<std::mutex> lock(poolMutex);
+		pool = {};
+	}
+
 private:
 	std::function<pointer_type()> createObject;
 	std::stack<std::shared_ptr<value_type>> pool;
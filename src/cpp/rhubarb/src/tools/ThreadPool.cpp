@@ -0,0 +1,222 @@
+#include "ThreadPool.h"
+
+#include <stdexcept>
+#include <utility>
+
+// The pool and worker index of the current thread, if it is a worker
+thread_local ThreadPool* currentThreadPool = nullptr;
+thread_local int currentWorkerIndex = -1;
+
+ThreadPool::ThreadPool(int workerCount) {
+	ensureWorkerCount(workerCount);
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	// Workers finish all queued tasks before they stop
+	for (auto& worker : workers) {
+		worker->thread.join();
+	}
+}
+
+void ThreadPool::ensureWorkerCount(int workerCount) {
+	std::lock_guard<std::mutex> lock(workersMutex);
+	while (static_cast<int>(workers.size()) < workerCount) {
+		const int workerIndex = static_cast<int>(workers.size());
+		workers.push_back(std::make_unique<Worker>());
+		workers.back()->thread = std::thread(&ThreadPool::workerLoop, this, workerIndex);
+	}
+}
+
+int ThreadPool::getWorkerCount() const {
+	std::lock_guard<std::mutex> lock(workersMutex);
+	return static_cast<int>(workers.size());
+}
+
+void ThreadPool::submit(Task task) {
+	Worker* worker;
+	{
+		std::lock_guard<std::mutex> lock(workersMutex);
+		if (workers.empty()) {
+			throw std::logic_error("Cannot submit a task to a thread pool without workers.");
+		}
+
+		// Keep tasks created by a worker local to it; distribute all others
+		const int workerIndex = currentThreadPool == this
+			? currentWorkerIndex
+			: nextWorkerIndex++ % static_cast<int>(workers.size());
+		worker = workers[workerIndex].get();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(worker->mutex);
+		worker->tasks.push_back(std::move(task));
+	}
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		++queuedTaskCount;
+	}
+	wake.notify_one();
+}
+
+bool ThreadPool::tryRunQueuedTask() {
+	Task task;
+	if (!tryStealTask(-1, task)) return false;
+
+	task();
+	return true;
+}
+
+void ThreadPool::workerLoop(int workerIndex) {
+	currentThreadPool = this;
+	currentWorkerIndex = workerIndex;
+
+	while (true) {
+		Task task;
+		if (tryPopTask(workerIndex, task) || tryStealTask(workerIndex, task)) {
+			task();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(wakeMutex);
+		wake.wait(lock, [&] { return stopping || queuedTaskCount > 0; });
+		if (stopping && queuedTaskCount == 0) return;
+	}
+}
+
+bool ThreadPool::tryPopTask(int workerIndex, Task& task) {
+	Worker* worker;
+	{
+		std::lock_guard<std::mutex> lock(workersMutex);
+		worker = workers[workerIndex].get();
+	}
+
+	{
+		// Take the newest task, whose data is most likely still cached
+		std::lock_guard<std::mutex> lock(worker->mutex);
+		if (worker->tasks.empty()) return false;
+
+		task = std::move(worker->tasks.back());
+		worker->tasks.pop_back();
+	}
+	std::lock_guard<std::mutex> lock(wakeMutex);
+	--queuedTaskCount;
+	return true;
+}
+
+bool ThreadPool::tryStealTask(int thiefIndex, Task& task) {
+	{
+		std::lock_guard<std::mutex> workersLock(workersMutex);
+		const int workerCount = static_cast<int>(workers.size());
+		bool found = false;
+		for (int i = 1; i <= workerCount && !found; ++i) {
+			// Start with the thief's neighbor, so that thieves spread over the workers
+			Worker& victim = *workers[(thiefIndex + i + workerCount) % workerCount];
+			if (&victim == (thiefIndex >= 0 ? workers[thiefIndex].get() : nullptr)) continue;
+
+			// Take the oldest task, which the victim is least likely to need soon
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (!victim.tasks.empty()) {
+				task = std::move(victim.tasks.front());
+				victim.tasks.pop_front();
+				found = true;
+			}
+		}
+		if (!found) return false;
+	}
+	std::lock_guard<std::mutex> lock(wakeMutex);
+	--queuedTaskCount;
+	return true;
+}
+
+ThreadPool& getThreadPool() {
+	static ThreadPool threadPool;
+	return threadPool;
+}
+
+TaskGroup::TaskGroup(ThreadPool& threadPool) :
+	threadPool(threadPool)
+{}
+
+TaskGroup::~TaskGroup() {
+	// Tasks may reference the caller's stack, so they must not outlive the group
+	cancel();
+	waitWithoutThrowing();
+}
+
+void TaskGroup::run(ThreadPool::Task task) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		++pendingTaskCount;
+	}
+	try {
+		threadPool.submit([this, task = std::move(task)] {
+			execute(task);
+
+			// Notify while holding the lock; the group may be destroyed as soon as it is released
+			std::lock_guard<std::mutex> lock(mutex);
+			--pendingTaskCount;
+			taskFinished.notify_all();
+		});
+	} catch (...) {
+		std::lock_guard<std::mutex> lock(mutex);
+		--pendingTaskCount;
+		throw;
+	}
+}
+
+void TaskGroup::runAndWait(ThreadPool::Task task) {
+	execute(task);
+	wait();
+}
+
+void TaskGroup::wait() {
+	waitWithoutThrowing();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (exception) {
+		std::rethrow_exception(std::exchange(exception, nullptr));
+	}
+}
+
+void TaskGroup::cancel() {
+	cancelled = true;
+}
+
+bool TaskGroup::isCancelled() const {
+	return cancelled;
+}
+
+void TaskGroup::execute(const ThreadPool::Task& task) {
+	if (cancelled) return;
+
+	try {
+		task();
+	} catch (...) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!exception) {
+			exception = std::current_exception();
+		}
+		cancelled = true;
+	}
+}
+
+void TaskGroup::waitWithoutThrowing() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (pendingTaskCount > 0) {
+		// Help with queued tasks rather than blocking a thread that might be a worker itself
+		lock.unlock();
+		const bool ranTask = threadPool.tryRunQueuedTask();
+		lock.lock();
+
+		// All tasks of this group have been taken by other threads
+		if (!ranTask) {
+			taskFinished.wait(lock, [&] { return pendingTaskCount == 0; });
+		}
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A set of worker threads that stay alive between tasks.
+// Each worker has its own task queue. Tasks submitted by a worker go to its own queue; a worker
+// that runs out of tasks steals the oldest task from another worker's queue.
+class ThreadPool {
+public:
+	using Task = std::function<void()>;
+
+	explicit ThreadPool(int workerCount = 0);
+	~ThreadPool();
+
+	// Starts additional workers, if necessary. Workers are never stopped before destruction.
+	void ensureWorkerCount(int workerCount);
+	int getWorkerCount() const;
+
+	// Queues a task. Tasks must not throw; use TaskGroup to propagate exceptions.
+	void submit(Task task);
+
+	// Runs one queued task on the calling thread, if there is one.
+	// Threads waiting for other tasks use this to help instead of blocking.
+	bool tryRunQueuedTask();
+
+private:
+	struct Worker {
+		std::deque<Task> tasks;
+		std::mutex mutex;
+		std::thread thread;
+	};
+
+	void workerLoop(int workerIndex);
+	bool tryPopTask(int workerIndex, Task& task);
+	bool tryStealTask(int thiefIndex, Task& task);
+
+	// Guards the worker list
+	mutable std::mutex workersMutex;
+	std::vector<std::unique_ptr<Worker>> workers;
+	int nextWorkerIndex = 0;
+
+	// Guards sleeping and waking of idle workers
+	std::mutex wakeMutex;
+	std::condition_variable wake;
+	int queuedTaskCount = 0;
+	bool stopping = false;
+};
+
+// Returns the pool shared by all parallel work in the process.
+// It is created on first use and lives until the process exits.
+ThreadPool& getThreadPool();
+
+// Tracks a number of tasks on a thread pool, so that their caller can wait for them.
+// The first exception thrown by a task cancels the group and is re-thrown by wait().
+// Cancellation only affects tasks that haven't started yet; running tasks can poll isCancelled().
+class TaskGroup {
+public:
+	explicit TaskGroup(ThreadPool& threadPool);
+	TaskGroup(const TaskGroup&) = delete;
+	TaskGroup& operator=(const TaskGroup&) = delete;
+	// Cancels and waits for any tasks still running, without re-throwing
+	~TaskGroup();
+
+	void run(ThreadPool::Task task);
+	// Runs the task on the calling thread, then waits for the group
+	void runAndWait(ThreadPool::Task task);
+	void wait();
+
+	void cancel();
+	bool isCancelled() const;
+
+private:
+	void execute(const ThreadPool::Task& task);
+	void waitWithoutThrowing();
+
+	ThreadPool& threadPool;
+	mutable std::mutex mutex;
+	std::condition_variable taskFinished;
+	int pendingTaskCount = 0;
+	std::atomic<bool> cancelled { false };
+	std::exception_ptr exception;
+};
@@ -0,0 +1,41 @@
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include "ThreadPool.h"
+
+void runParallel(
+	size_t elementCount,
+	const std::function<void(size_t)>& processElement,
+	int maxThreadCount)
+{
+	if (maxThreadCount < 1) {
+		throw std::invalid_argument(fmt::format("maxThreadCount cannot be {}.", maxThreadCount));
+	}
+
+	const size_t threadCount = std::min(static_cast<size_t>(maxThreadCount), elementCount);
+	if (threadCount <= 1) {
+		// Process synchronously
+		for (size_t index = 0; index < elementCount; ++index) {
+			processElement(index);
+		}
+		return;
+	}
+
+	ThreadPool& threadPool = getThreadPool();
+	threadPool.ensureWorkerCount(static_cast<int>(threadCount) - 1);
+
+	// Each thread keeps claiming the next unprocessed element, so no thread runs idle while
+	// others still have a backlog
+	TaskGroup taskGroup(threadPool);
+	std::atomic<size_t> nextIndex { 0 };
+	auto processElements = [&] {
+		for (size_t index = nextIndex++; index < elementCount && !taskGroup.isCancelled(); index = nextIndex++) {
+			processElement(index);
+		}
+	};
+	for (size_t i = 1; i < threadCount; ++i) {
+		taskGroup.run(processElements);
+	}
+	taskGroup.runAndWait(processElements);
+}
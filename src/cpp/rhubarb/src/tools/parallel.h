@@ -1,9 +1,20 @@
 #pragma once
 
 #include <functional>
-#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include <format.h>
 #include "progress.h"
-#include <gsl_util.h>
+
+// Calls processElement for each index in [0, elementCount), using up to maxThreadCount threads
+// including the calling thread. The other threads are taken from the process-wide thread pool.
+// If processing an element throws, no further elements are started and the first exception is
+// re-thrown once all running elements are done.
+void runParallel(
+	size_t elementCount,
+	const std::function<void(size_t)>& processElement,
+	int maxThreadCount);
 
 template<typename TCollection>
 void runParallel(
@@ -11,73 +22,16 @@ void runParallel(
 	TCollection& collection,
 	int maxThreadCount)
 {
-	if (maxThreadCount < 1) {
-		throw std::invalid_argument(fmt::format("maxThreadCount cannot be {}.", maxThreadCount));
-	}
-
-	if (maxThreadCount == 1) {
-		// Process synchronously
-		for (auto& element : collection) {
-			processElement(element);
-		}
-		return;
-	}
-
-	using future_type = std::future<void>;
-
-	std::mutex mutex;
-	int currentThreadCount = 0;
-	std::condition_variable elementFinished;
-	future_type finishedElement;
-
-	// Before exiting, wait for all running tasks to finish, but don't re-throw exceptions.
-	// This only applies if one task already failed with an exception.
-	auto finishRunning = gsl::finally([&] {
-		std::unique_lock<std::mutex> lock(mutex);
-		elementFinished.wait(lock, [&] { return currentThreadCount == 0; });
-	});
-
-	// Asynchronously run all elements
+	std::vector<decltype(collection.begin())> elements;
 	for (auto it = collection.begin(); it != collection.end(); ++it) {
-		// This variable will later hold the future, but can be value-captured right now
-		auto future = std::make_shared<future_type>();
-
-		// Notifies that an element is done processing
-		auto notifyElementDone = [&, future] {
-			std::lock_guard<std::mutex> lock(mutex);
-			finishedElement = std::move(*future);
-			--currentThreadCount;
-			elementFinished.notify_one();
-		};
-
-		// Processes the current element, then notifies
-		auto wrapperFunction = [processElement, &element = *it, notifyElementDone]() {
-			auto done = gsl::finally(notifyElementDone);
-			processElement(element);
-		};
-
-		// Asynchronously process element
-		{
-			std::lock_guard<std::mutex> lock(mutex);
-			*future = std::async(std::launch::async, wrapperFunction);
-			++currentThreadCount;
-		}
-
-		// Wait for threads to finish, if necessary
-		{
-			std::unique_lock<std::mutex> lock(mutex);
-			const int targetThreadCount = it == collection.end() ? 0 : maxThreadCount - 1;
-			while (currentThreadCount > targetThreadCount) {
-				elementFinished.wait(lock);
-				if (finishedElement.valid()) {
-					// Re-throw any exception
-					finishedElement.get();
-					finishedElement = future_type();
-				}
-			}
-		}
+		elements.push_back(it);
 	}
 
+	runParallel(
+		elements.size(),
+		[&](size_t index) { processElement(*elements[index]); },
+		maxThreadCount
+	);
 }
 
 template<typename TCollection>
@@ -90,22 +44,26 @@ void runParallel(
 	std::function<double(typename TCollection::reference)> getElementProgressWeight =
 		[](typename TCollection::reference) { return 1.0; })
 {
-	// Create a collection of wrapper functions that take care of progress handling
+	// Give each element its own progress sink
 	ProgressMerger progressMerger(progressSink);
-	std::vector<std::function<void()>> functions;
+	std::vector<decltype(collection.begin())> elements;
+	std::vector<ProgressSink*> elementProgressSinks;
 	int elementIndex = 0;
-	for (auto& element : collection) {
-		auto& elementProgressSink = progressMerger.addSource(
+	for (auto it = collection.begin(); it != collection.end(); ++it) {
+		elements.push_back(it);
+		elementProgressSinks.push_back(&progressMerger.addSource(
 			fmt::format("runParallel ({}) #{}", description, elementIndex),
-			getElementProgressWeight(element)
-		);
-		functions.push_back([&]() { processElement(element, elementProgressSink); });
+			getElementProgressWeight(*it)
+		));
 
 		++elementIndex;
 	}
 
-	// Run wrapper function
-	runParallel([&](std::function<void()> function) { function(); }, functions, maxThreadCount);
+	runParallel(
+		elements.size(),
+		[&](size_t index) { processElement(*elements[index], *elementProgressSinks[index]); },
+		maxThreadCount
+	);
 }
 
 inline int getProcessorCoreCount() {
@@ -0,0 +1,172 @@
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <stdexcept>
+#include "rhubarb/src/lib/rhubarbLib.h"
+#include "rhubarb/src/recognition/PocketSphinxRecognizer.h"
+#include "rhubarb/src/recognition/pocketSphinxTools.h"
+#include "rhubarb/src/audio/MemoryAudioClip.h"
+#include "rhubarb/src/audio/SampleRateConverter.h"
+#include "rhubarb/src/tools/textFiles.h"
+#include "rhubarb/src/tools/parallel.h"
+#include "rhubarb/src/tools/exceptions.h"
+#include <boost/optional.hpp>
+
+// Native command line front end.
+// Produces the same JSON as the WASM getLipSync() function, using the same core code path.
+
+// Audio samples read from a file
+struct PcmAudio {
+    std::vector<int16_t> samples;
+    int sampleRate = sphinxSampleRate;
+};
+
+template<typename T>
+T readLittleEndian(const char* data) {
+    T value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        value |= static_cast<T>(static_cast<uint8_t>(data[i])) << (8 * i);
+    }
+    return value;
+}
+
+// Reads 16-bit mono PCM, either as a WAVE file or as raw samples at 16kHz
+PcmAudio readPcmFile(const std::string& filePath) {
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Could not open file " + filePath + ".");
+    }
+    const std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    PcmAudio audio;
+    const char* data = bytes.data();
+    size_t dataSize = bytes.size();
+    if (bytes.size() >= 12 && std::memcmp(data, "RIFF", 4) == 0 && std::memcmp(data + 8, "WAVE", 4) == 0) {
+        bool hasFormat = false;
+        bool hasData = false;
+        size_t offset = 12;
+        while (offset + 8 <= bytes.size() && !hasData) {
+            const char* chunk = data + offset;
+            const size_t chunkSize = std::min<size_t>(readLittleEndian<uint32_t>(chunk + 4), bytes.size() - offset - 8);
+            if (std::memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16) {
+                const uint16_t formatTag = readLittleEndian<uint16_t>(chunk + 8);
+                const uint16_t channelCount = readLittleEndian<uint16_t>(chunk + 10);
+                const uint16_t bitsPerSample = readLittleEndian<uint16_t>(chunk + 22);
+                if (formatTag != 1 || channelCount != 1 || bitsPerSample != 16) {
+                    throw std::runtime_error("Only 16-bit mono PCM WAVE files are supported.");
+                }
+                audio.sampleRate = static_cast<int>(readLittleEndian<uint32_t>(chunk + 12));
+                hasFormat = true;
+            } else if (std::memcmp(chunk, "data", 4) == 0) {
+                data = chunk + 8;
+                dataSize = chunkSize;
+                hasData = true;
+            }
+            // Chunks are padded to an even size
+            offset += 8 + chunkSize + (chunkSize & 1);
+        }
+        if (!hasFormat || !hasData) {
+            throw std::runtime_error("Invalid WAVE file " + filePath + ".");
+        }
+    }
+
+    audio.samples.resize(dataSize / sizeof(int16_t));
+    for (size_t i = 0; i < audio.samples.size(); ++i) {
+        audio.samples[i] = readLittleEndian<int16_t>(data + i * sizeof(int16_t));
+    }
+    return audio;
+}
+
+std::string escapeJson(const std::string& value) {
+    std::string result;
+    for (char c : value) {
+        if (c == '"' || c == '\\') result += '\\';
+        result += c;
+    }
+    return result;
+}
+
+void printJson(const std::vector<MouthCue>& mouthCues, std::ostream& stream) {
+    stream << std::fixed << std::setprecision(2);
+    stream << "{\n  \"mouthCues\": [";
+    for (size_t i = 0; i < mouthCues.size(); ++i) {
+        const MouthCue& cue = mouthCues[i];
+        stream << (i == 0 ? "\n" : ",\n")
+            << "    { \"start\": " << cue.start
+            << ", \"end\": " << cue.end
+            << ", \"value\": \"" << escapeJson(cue.value) << "\""
+            << ", \"shape\": " << static_cast<int>(cue.shape) << " }";
+    }
+    stream << (mouthCues.empty() ? "]\n}\n" : "\n  ]\n}\n");
+}
+
+void printUsage(std::ostream& stream) {
+    stream << "Usage: rhubarb-cli [-d <dialog file> [-e] [-g]] [-c] [-j <thread count>] <audio file>\n"
+        << "The audio file must be a 16-bit mono PCM WAVE file, or raw 16-bit mono PCM at 16kHz.\n"
+        << "-e (--exactDialog) aligns the dialog directly, for audio that says exactly the dialog text.\n"
+        << "-g (--dialogGrammar) recognizes only the words of the dialog, using a grammar.\n"
+        << "-c (--compactModel) uses the compact language model, if it was built.\n";
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        boost::optional<std::string> dialogFilePath;
+        bool exactDialog = false;
+        bool dialogGrammar = false;
+        LanguageModelVariant languageModel = LanguageModelVariant::Full;
+        int maxThreadCount = getProcessorCoreCount();
+        boost::optional<std::string> inputFilePath;
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if ((arg == "-d" || arg == "--dialogFile") && i + 1 < argc) {
+                dialogFilePath = std::string(argv[++i]);
+            } else if (arg == "-e" || arg == "--exactDialog") {
+                exactDialog = true;
+            } else if (arg == "-g" || arg == "--dialogGrammar") {
+                dialogGrammar = true;
+            } else if (arg == "-c" || arg == "--compactModel") {
+                languageModel = LanguageModelVariant::Compact;
+            } else if ((arg == "-j" || arg == "--threads") && i + 1 < argc) {
+                maxThreadCount = std::stoi(argv[++i]);
+            } else if (arg == "-h" || arg == "--help") {
+                printUsage(std::cout);
+                return 0;
+            } else if (!inputFilePath && !arg.empty() && arg[0] != '-') {
+                inputFilePath = arg;
+            } else {
+                printUsage(std::cerr);
+                return 1;
+            }
+        }
+        if (!inputFilePath) {
+            printUsage(std::cerr);
+            return 1;
+        }
+
+        const boost::optional<std::string> dialog = dialogFilePath
+            ? boost::optional<std::string>(readUtf8File(*dialogFilePath))
+            : boost::none;
+
+        const PcmAudio audio = readPcmFile(*inputFilePath);
+        const std::unique_ptr<AudioClip> audioClip =
+            std::make_unique<MemoryAudioClip<int16_t>>(audio.samples.data(), audio.samples.size(), audio.sampleRate)
+            | resample(sphinxSampleRate);
+
+        PocketSphinxRecognizer recognizer(languageModel);
+        recognizer.setExactDialog(exactDialog);
+        recognizer.setDialogGrammar(dialogGrammar);
+        NullProgressSink progressSink;
+        const std::vector<MouthCue> mouthCues =
+            animateAudioClip(*audioClip, dialog, recognizer, maxThreadCount, progressSink);
+
+        printJson(mouthCues, std::cout);
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << getMessage(e) << std::endl;
+        return 1;
+    }
+}
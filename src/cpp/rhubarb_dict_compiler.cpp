@@ -0,0 +1,55 @@
+#include <string>
+#include <iostream>
+#include <stdexcept>
+#include "rhubarb/src/tools/tools.h"
+
+extern "C" {
+#include <pocketsphinx.h>
+#include <bin_mdef.h>
+#include <dict.h>
+}
+
+// Offline dictionary compiler.
+// Converts a text pronunciation dictionary into the compiled format that PocketSphinx maps into
+// memory instead of parsing. Phone IDs are resolved against the acoustic model, so the output
+// must be recompiled whenever the acoustic model changes.
+
+void printUsage(std::ostream& stream) {
+    stream << "Usage: rhubarb-dict-compiler <acoustic model directory> <dictionary> <output file>\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 4) {
+        printUsage(std::cerr);
+        return 1;
+    }
+    const std::string modelDirectory = argv[1];
+    const std::string dictionaryPath = argv[2];
+    const std::string outputPath = argv[3];
+
+    try {
+        lambda_unique_ptr<cmd_ln_t> config(
+            cmd_ln_init(nullptr, ps_args(), true, "-dict", dictionaryPath.c_str(), nullptr),
+            [](cmd_ln_t* config) { cmd_ln_free_r(config); });
+        if (!config) throw std::runtime_error("Error creating configuration.");
+
+        const std::string mdefPath = modelDirectory + "/mdef";
+        lambda_unique_ptr<bin_mdef_t> mdef(
+            bin_mdef_read(nullptr, mdefPath.c_str()),
+            [](bin_mdef_t* mdef) { bin_mdef_free(mdef); });
+        if (!mdef) throw std::runtime_error("Error reading acoustic model " + mdefPath + ".");
+
+        lambda_unique_ptr<dict_t> dictionary(
+            dict_init(config.get(), mdef.get()),
+            [](dict_t* dictionary) { dict_free(dictionary); });
+        if (!dictionary) throw std::runtime_error("Error reading dictionary " + dictionaryPath + ".");
+
+        if (dict_write(dictionary.get(), outputPath.c_str(), "bin") < 0) {
+            throw std::runtime_error("Error writing compiled dictionary " + outputPath + ".");
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,233 @@
+#include <string>
+#include <vector>
+#include <set>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <filesystem>
+#include "rhubarb/src/tools/tools.h"
+
+extern "C" {
+#include <sphinxbase/logmath.h>
+#include <sphinxbase/ngram_model.h>
+#include <ngram_model_trie.h>
+}
+
+// Offline language model compiler.
+// Builds a compact variant of a language model: probabilities are quantized to fewer bits, and
+// optionally words without a pronunciation and improbable words and n-grams are dropped. The
+// result is written in the binary trie format that the recognizer maps into memory.
+
+struct Ngram {
+    std::vector<uint32> words;  // Text order, IDs of the source model
+    float probability;          // log10
+    float backoffWeight;        // log10
+};
+
+struct Options {
+    std::string dictionaryPath;
+    float minUnigramProbability = -99.0f;
+    float minNgramProbability = -99.0f;
+    int quantizationBits = 8;
+    std::string modelPath;
+    std::string outputPath;
+};
+
+void printUsage(std::ostream& stream) {
+    stream << "Usage: rhubarb-lm-compiler [options] <language model> <output file>\n"
+        << "\n"
+        << "Options:\n"
+        << "  -d, --dictionary <file>  Only keep words with a pronunciation in this dictionary\n"
+        << "  -u, --minUnigram <log>   Drop words with a lower log10 unigram probability\n"
+        << "  -p, --minNgram <log>     Drop n-grams with a lower log10 probability, unless\n"
+        << "                           a kept longer n-gram needs them\n"
+        << "  -b, --bits <count>       Bits per quantized probability, "
+        << LM_TRIE_QUANT_MIN_BITS << " to " << LM_TRIE_QUANT_MAX_BITS << " (default: 8)\n"
+        << "  -h, --help               Show this help\n";
+}
+
+Options parseArguments(int argc, char* argv[]) {
+    Options options;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto nextValue = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + arg + ".");
+            return argv[++i];
+        };
+        if (arg == "-d" || arg == "--dictionary") {
+            options.dictionaryPath = nextValue();
+        } else if (arg == "-u" || arg == "--minUnigram") {
+            options.minUnigramProbability = std::stof(nextValue());
+        } else if (arg == "-p" || arg == "--minNgram") {
+            options.minNgramProbability = std::stof(nextValue());
+        } else if (arg == "-b" || arg == "--bits") {
+            options.quantizationBits = std::stoi(nextValue());
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage(std::cout);
+            exit(0);
+        } else if (!arg.empty() && arg[0] == '-') {
+            throw std::invalid_argument("Unknown option " + arg + ".");
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.size() != 2) throw std::invalid_argument("Expected a language model and an output file.");
+    if (options.quantizationBits < LM_TRIE_QUANT_MIN_BITS || options.quantizationBits > LM_TRIE_QUANT_MAX_BITS) {
+        throw std::invalid_argument("Unsupported number of bits.");
+    }
+    options.modelPath = positional[0];
+    options.outputPath = positional[1];
+    return options;
+}
+
+// Reads the words of a text pronunciation dictionary, ignoring alternative pronunciations
+std::set<std::string> readDictionaryWords(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) throw std::runtime_error("Error reading dictionary " + path + ".");
+    std::set<std::string> words;
+    std::string line;
+    while (std::getline(file, line)) {
+        const std::string word = line.substr(0, line.find_first_of(" \t"));
+        if (word.empty()) continue;
+        const size_t variantStart = word.find('(');
+        words.insert(variantStart == std::string::npos ? word : word.substr(0, variantStart));
+    }
+    return words;
+}
+
+struct NgramCollector {
+    logmath_t* lmath;
+    std::vector<std::vector<Ngram>>* ngramsByOrder;
+};
+
+void collectNgram(void* data, uint32 const* words, int n, float probability, float backoffWeight) {
+    // Unigrams are selected separately
+    if (n < 2) return;
+
+    const NgramCollector& collector = *static_cast<NgramCollector*>(data);
+    (*collector.ngramsByOrder)[n].push_back({
+        std::vector<uint32>(words, words + n),
+        static_cast<float>(logmath_log_float_to_log10(collector.lmath, probability)),
+        static_cast<float>(logmath_log_float_to_log10(collector.lmath, backoffWeight))
+    });
+}
+
+// Drops improbable n-grams, starting with the longest. An n-gram stays if a kept longer n-gram
+// uses it as context or as the n-gram it backs off to.
+void pruneNgrams(std::vector<std::vector<Ngram>>& ngramsByOrder, float minProbability) {
+    std::set<std::vector<uint32>> required;
+    for (size_t n = ngramsByOrder.size() - 1; n >= 2; --n) {
+        std::vector<Ngram> kept;
+        for (Ngram& ngram : ngramsByOrder[n]) {
+            if (ngram.probability < minProbability && !required.count(ngram.words)) continue;
+            if (n > 2) {
+                required.emplace(ngram.words.begin(), ngram.words.end() - 1);
+                required.emplace(ngram.words.begin() + 1, ngram.words.end());
+            }
+            kept.push_back(std::move(ngram));
+        }
+        ngramsByOrder[n] = std::move(kept);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        const Options options = parseArguments(argc, argv);
+
+        lambda_unique_ptr<logmath_t> lmath(
+            logmath_init(1.0001, 0, 0),
+            [](logmath_t* lmath) { logmath_free(lmath); });
+        lambda_unique_ptr<ngram_model_t> source(
+            ngram_model_read(nullptr, options.modelPath.c_str(), NGRAM_AUTO, lmath.get()),
+            [](ngram_model_t* model) { ngram_model_free(model); });
+        if (!source) throw std::runtime_error("Error reading language model " + options.modelPath + ".");
+        const int order = ngram_model_get_size(source.get());
+        const uint32* sourceCounts = reinterpret_cast<const uint32*>(ngram_model_get_counts(source.get()));
+        lm_trie_t* trie = reinterpret_cast<ngram_model_trie_t*>(source.get())->trie;
+
+        // Select the words to keep. Sentence markers like <s> never have a pronunciation.
+        std::set<std::string> dictionaryWords;
+        if (!options.dictionaryPath.empty()) {
+            dictionaryWords = readDictionaryWords(options.dictionaryPath);
+        }
+        std::vector<uint8> keepWord(sourceCounts[0]);
+        std::vector<uint32> newWordIds(sourceCounts[0]);
+        std::vector<const char*> wordStrings;
+        std::vector<float32> unigramProbabilities;
+        std::vector<float32> unigramBackoffWeights;
+        for (uint32 wordId = 0; wordId < sourceCounts[0]; ++wordId) {
+            const char* word = ngram_word(source.get(), wordId);
+            const unigram_t& unigram = trie->unigrams[wordId];
+            const float probability = static_cast<float>(logmath_log_float_to_log10(lmath.get(), unigram.prob));
+            const bool isMarker = word[0] == '<';
+            const bool hasPronunciation = dictionaryWords.empty() || dictionaryWords.count(word);
+            if (!isMarker && (!hasPronunciation || probability < options.minUnigramProbability)) continue;
+
+            keepWord[wordId] = 1;
+            newWordIds[wordId] = static_cast<uint32>(wordStrings.size());
+            wordStrings.push_back(word);
+            unigramProbabilities.push_back(probability);
+            unigramBackoffWeights.push_back(static_cast<float32>(logmath_log_float_to_log10(lmath.get(), unigram.bo)));
+        }
+
+        std::vector<std::vector<Ngram>> ngramsByOrder(order + 1);
+        NgramCollector collector { lmath.get(), &ngramsByOrder };
+        lm_trie_visit_ngrams(trie, sourceCounts[0], order, keepWord.data(), &collectNgram, &collector);
+        pruneNgrams(ngramsByOrder, options.minNgramProbability);
+
+        // The trie is built from n-grams whose words are stored last word first
+        std::vector<uint32> counts { static_cast<uint32>(wordStrings.size()) };
+        std::vector<std::vector<uint32>> rawWords(order + 1);
+        std::vector<std::vector<ngram_raw_t>> rawNgrams(order + 1);
+        std::vector<ngram_raw_t*> rawNgramPointers;
+        for (int n = 2; n <= order; ++n) {
+            const std::vector<Ngram>& ngrams = ngramsByOrder[n];
+            rawWords[n].reserve(ngrams.size() * n);
+            for (const Ngram& ngram : ngrams) {
+                for (int i = n - 1; i >= 0; --i) {
+                    rawWords[n].push_back(newWordIds[ngram.words[i]]);
+                }
+            }
+            rawNgrams[n].resize(ngrams.size());
+            for (size_t i = 0; i < ngrams.size(); ++i) {
+                rawNgrams[n][i].words = &rawWords[n][i * n];
+                rawNgrams[n][i].prob = ngrams[i].probability;
+                rawNgrams[n][i].backoff = ngrams[i].backoffWeight;
+            }
+            counts.push_back(static_cast<uint32>(ngrams.size()));
+            rawNgramPointers.push_back(rawNgrams[n].data());
+        }
+
+        lambda_unique_ptr<ngram_model_t> compact(
+            ngram_model_trie_build_quant(
+                nullptr,
+                lmath.get(),
+                order,
+                counts.data(),
+                wordStrings.data(),
+                unigramProbabilities.data(),
+                unigramBackoffWeights.data(),
+                rawNgramPointers.data(),
+                options.quantizationBits
+            ),
+            [](ngram_model_t* model) { ngram_model_free(model); });
+        if (ngram_model_trie_write_bin(compact.get(), options.outputPath.c_str()) < 0) {
+            throw std::runtime_error("Error writing language model " + options.outputPath + ".");
+        }
+
+        for (int n = 1; n <= order; ++n) {
+            std::cerr << n << "-grams: " << sourceCounts[n - 1] << " -> " << counts[n - 1] << "\n";
+        }
+        std::cerr << "Size: " << std::filesystem::file_size(options.modelPath) << " -> "
+            << std::filesystem::file_size(options.outputPath) << " bytes\n";
+        return 0;
+    } catch (const std::invalid_argument& e) {
+        std::cerr << "Error: " << e.what() << "\n\n";
+        printUsage(std::cerr);
+        return 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
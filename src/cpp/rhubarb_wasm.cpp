@@ -14,10 +14,10 @@
 #include <iomanip>
 #include <optional>
 #include "rhubarb/src/recognition/PocketSphinxRecognizer.h"
-#include "rhubarb/src/recognition/Recognizer.h"
-#include "rhubarb/src/audio/audioFileReading.h"
+#include "rhubarb/src/recognition/StreamingPhoneRecognizer.h"
+#include "rhubarb/src/lib/rhubarbLib.h"
 #include "rhubarb/src/audio/AudioClip.h"
-#include "rhubarb/src/audio/BufferAudioClip.h"
+#include "rhubarb/src/audio/MemoryAudioClip.h"
 #include "rhubarb/src/tools/progress.h"
 #include "rhubarb/src/core/Shape.h"
 #include <boost/optional.hpp>
@@ -36,16 +36,18 @@ std::string formatNumber(T value, int precision = 2) {
     return ss.str();
 }
 
-struct MouthCue {
-  double start;
-  double end;
-  std::string value;
-};
-
 struct LipSyncResult {
   std::vector<MouthCue> mouthCues;
 };
 
+// Mouth cues as parallel arrays.
+// Returned to JS as typed array views into WASM memory, so no per-cue objects are created.
+struct MouthCueColumns {
+  std::vector<double> start;
+  std::vector<double> end;
+  std::vector<uint8_t> shape;
+};
+
 // Audio format information
 struct AudioFormatInfo {
     int channelCount;
@@ -69,293 +71,198 @@ public:
     }
 };
 
-// Helper function to get shape set for a phone with timing context
-ShapeSet getPhoneShapeSet(const Phone& phone, centiseconds duration, centiseconds previousDuration) {
-    static const ShapeSet any { Shape::A, Shape::B, Shape::C, Shape::D, Shape::E, Shape::F, Shape::G, Shape::H, Shape::X };
-    static const ShapeSet anyOpen { Shape::B, Shape::C, Shape::D, Shape::E, Shape::F, Shape::G, Shape::H };
-
-    switch (phone) {
-        case Phone::AO: return { Shape::E };
-        case Phone::AA: return { Shape::D };
-        case Phone::IY: return { Shape::B };
-        case Phone::UW: return { Shape::F };
-        case Phone::EH: return { Shape::C };
-        case Phone::IH: return { Shape::B };
-        case Phone::UH: return { Shape::F };
-        case Phone::AH: return duration < 20_cs ? ShapeSet{ Shape::C } : ShapeSet{ Shape::D };
-        case Phone::Schwa: return { Shape::B, Shape::C };
-        case Phone::AE: return { Shape::C };
-        case Phone::EY: return duration < 20_cs ? ShapeSet{ Shape::C, Shape::B } : ShapeSet{ Shape::D, Shape::B };
-        case Phone::AY: return duration < 20_cs ? ShapeSet{ Shape::C, Shape::B } : ShapeSet{ Shape::D, Shape::B };
-        case Phone::OW: return { Shape::E, Shape::F };
-        case Phone::AW: return duration < 30_cs ? ShapeSet{ Shape::C, Shape::E } : ShapeSet{ Shape::D, Shape::E };
-        case Phone::OY: return { Shape::E, Shape::B };
-        case Phone::ER: return duration < 7_cs ? ShapeSet{ Shape::B, Shape::C } : ShapeSet{ Shape::E };
-        
-        // Plosives
-        case Phone::P:
-        case Phone::B: return any;  // Note: Plosive timing handled separately
-        case Phone::T:
-        case Phone::D: return anyOpen;  // Note: Plosive timing handled separately
-        case Phone::K:
-        case Phone::G: return { Shape::B, Shape::C, Shape::E, Shape::F, Shape::H };
-        
-        // Affricates
-        case Phone::CH:
-        case Phone::JH: return { Shape::B, Shape::F };
-        
-        // Fricatives
-        case Phone::F:
-        case Phone::V: return { Shape::G };
-        case Phone::TH:
-        case Phone::DH:
-        case Phone::S:
-        case Phone::Z:
-        case Phone::SH:
-        case Phone::ZH: return { Shape::B, Shape::F };
-        case Phone::HH: return any;  // think "m-hm"
-        
-        // Nasals
-        case Phone::M: return { Shape::A };
-        case Phone::N: return { Shape::B, Shape::C, Shape::F, Shape::H };
-        case Phone::NG: return { Shape::B, Shape::C, Shape::E, Shape::F };
-        
-        // Liquids and Glides
-        case Phone::L: return duration < 20_cs 
-            ? ShapeSet{ Shape::B, Shape::E, Shape::F, Shape::H }
-            : ShapeSet{ Shape::H };
-        case Phone::R: return { Shape::B, Shape::E, Shape::F };
-        case Phone::Y: return { Shape::B, Shape::C, Shape::F };
-        case Phone::W: return { Shape::F };
-        
-        // Non-speech sounds
-        case Phone::Breath:
-        case Phone::Cough:
-        case Phone::Smack: return { Shape::C };
-        case Phone::Noise: return { Shape::B };
-        
-        default: return { Shape::X };
+// Returns the number of threads to use for speech recognition
+int getRecognitionThreadCount() {
+#ifdef __EMSCRIPTEN_PTHREADS__
+    // The calling thread takes part in recognition. The others are persistent threads of the
+    // process-wide thread pool, each backed by a Web Worker that the loader creates at startup.
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+#else
+    // Without pthreads, no threads can be started
+    return 1;
+#endif
+}
+
+// Copies the contents of a JS typed array into WASM memory using a single bulk copy.
+// The typed array is reinterpreted as raw bytes, so it may be of any element type and alignment.
+template<typename T>
+std::vector<T> copyTypedArray(const emscripten::val& typedArray) {
+    const size_t byteLength = typedArray["byteLength"].as<size_t>();
+    std::vector<T> result(byteLength / sizeof(T));
+
+    const emscripten::val sourceBytes = emscripten::val::global("Uint8Array").new_(
+        typedArray["buffer"],
+        typedArray["byteOffset"],
+        result.size() * sizeof(T)
+    );
+    emscripten::val targetBytes(emscripten::typed_memory_view(
+        result.size() * sizeof(T),
+        reinterpret_cast<uint8_t*>(result.data())
+    ));
+    targetBytes.call<void>("set", sourceBytes);
+
+    return result;
+}
+
+// Returns 16-bit PCM data (a Buffer or Int16Array) as an Int16Array over the same memory.
+// Int16Array requires 2-byte alignment, so a Buffer at an odd byte offset is copied on the JS side.
+emscripten::val toInt16Array(const emscripten::val& pcmData) {
+    if (pcmData.instanceof(emscripten::val::global("Int16Array"))) return pcmData;
+
+    const size_t byteLength = pcmData["byteLength"].as<size_t>() / sizeof(int16_t) * sizeof(int16_t);
+    emscripten::val bytes = emscripten::val::global("Uint8Array").new_(
+        pcmData["buffer"], pcmData["byteOffset"], byteLength);
+    if (pcmData["byteOffset"].as<size_t>() % sizeof(int16_t) != 0) {
+        bytes = bytes.call<emscripten::val>("slice");
     }
+    return emscripten::val::global("Int16Array").new_(
+        bytes["buffer"], bytes["byteOffset"], byteLength / sizeof(int16_t));
 }
 
-// Effort matrix for shape transitions
-Shape getClosestShape(Shape reference, const ShapeSet& shapes) {
-    if (shapes.empty()) {
-        return Shape::X;
+// Converts mouth cues to a JS array of objects
+emscripten::val toMouthCueArray(const std::vector<MouthCue>& mouthCues) {
+    emscripten::val mouthCuesArray = emscripten::val::array();
+    for (const auto& cue : mouthCues) {
+        emscripten::val cueObj = emscripten::val::object();
+        cueObj.set("start", cue.start);
+        cueObj.set("end", cue.end);
+        cueObj.set("value", cue.value);
+        cueObj.set("shape", cue.shape);
+        mouthCuesArray.call<void>("push", cueObj);
     }
+    return mouthCuesArray;
+}
 
-    static const std::array<std::array<Shape, 9>, 9> effortMatrix = {{
-        /* A */ {{ Shape::A, Shape::X, Shape::G, Shape::B, Shape::C, Shape::H, Shape::E, Shape::D, Shape::F }},
-        /* B */ {{ Shape::B, Shape::G, Shape::A, Shape::X, Shape::C, Shape::H, Shape::E, Shape::D, Shape::F }},
-        /* C */ {{ Shape::C, Shape::H, Shape::B, Shape::G, Shape::D, Shape::A, Shape::X, Shape::E, Shape::F }},
-        /* D */ {{ Shape::D, Shape::C, Shape::H, Shape::B, Shape::G, Shape::A, Shape::X, Shape::E, Shape::F }},
-        /* E */ {{ Shape::E, Shape::C, Shape::H, Shape::B, Shape::G, Shape::A, Shape::X, Shape::D, Shape::F }},
-        /* F */ {{ Shape::F, Shape::B, Shape::G, Shape::A, Shape::X, Shape::C, Shape::H, Shape::E, Shape::D }},
-        /* G */ {{ Shape::G, Shape::A, Shape::B, Shape::C, Shape::H, Shape::X, Shape::E, Shape::D, Shape::F }},
-        /* H */ {{ Shape::H, Shape::C, Shape::B, Shape::G, Shape::D, Shape::A, Shape::X, Shape::E, Shape::F }},
-        /* X */ {{ Shape::X, Shape::A, Shape::G, Shape::B, Shape::C, Shape::H, Shape::E, Shape::D, Shape::F }}
-    }};
-
-    const auto& closestShapes = effortMatrix[static_cast<size_t>(reference)];
-    for (Shape closestShape : closestShapes) {
-        if (shapes.find(closestShape) != shapes.end()) {
-            return closestShape;
-        }
+// Lip sync engine that keeps its speech decoders warm between calls.
+// Creating a decoder means loading the dictionary, the acoustic model and the language model,
+// so reusing an engine reduces the cost of a call to the actual decoding time.
+class LipSyncEngine {
+public:
+    LipSyncEngine() = default;
+
+    // Optionally uses the compact language model, which loads faster and needs less memory
+    explicit LipSyncEngine(bool compactLanguageModel) :
+        recognizer(compactLanguageModel ? LanguageModelVariant::Compact : LanguageModelVariant::Full)
+    {}
+
+    // Processes audio and generates lip sync data
+    // Note: pcmData is expected to be a Buffer or Int16Array containing 16-bit PCM mono at 16kHz,
+    // or a Float32Array containing samples in the range -1..1 at 16kHz
+    emscripten::val getLipSync(emscripten::val pcmData, const std::string& dialogText);
+
+    // Processes 16-bit samples the caller has written to WASM memory (e.g. via _malloc and HEAP16).
+    // The samples are used in place. The memory must stay valid until this function returns.
+    emscripten::val getLipSyncFromInt16Pointer(
+        uintptr_t samples, size_t sampleCount, const std::string& dialogText
+    ) {
+        const MemoryAudioClip<int16_t> audioClip(
+            reinterpret_cast<const int16_t*>(samples), sampleCount, AudioFormatInfo().frameRate);
+        return processAudioClip(audioClip, dialogText);
     }
 
-    return *shapes.begin();  // Fallback to first available shape
-}
+    // Processes float samples the caller has written to WASM memory (e.g. via _malloc and HEAPF32).
+    // The samples are used in place. The memory must stay valid until this function returns.
+    emscripten::val getLipSyncFromFloat32Pointer(
+        uintptr_t samples, size_t sampleCount, const std::string& dialogText
+    ) {
+        const MemoryAudioClip<float> audioClip(
+            reinterpret_cast<const float*>(samples), sampleCount, AudioFormatInfo().frameRate);
+        return processAudioClip(audioClip, dialogText);
+    }
 
-// Helper function to convert Shape to string
-std::string shapeToString(Shape shape) {
-    std::ostringstream stream;
-    stream << shape;  // This uses the operator<< defined for Shape
-    return stream.str();
-}
+    // Makes sure that the specified number of decoders are ready for use
+    void prewarm(int decoderCount) {
+        recognizer.prewarm(decoderCount);
+    }
 
-// Process phones and generate mouth cues
-std::vector<MouthCue> processPhones(const BoundedTimeline<Phone>& phones, double audioDurationSeconds) {
-    std::vector<MouthCue> mouthCues;
-    Shape currentShape = Shape::X;
-    
-    // Add initial X shape if there's a gap at the start
-    if (phones.begin() != phones.end() && phones.begin()->getTimeRange().getStart() > 0_cs) {
-        mouthCues.push_back({
-            0.0,
-            phones.begin()->getTimeRange().getStart().count() / 100.0,
-            shapeToString(Shape::X)
-        });
+    // Frees all idle decoders and the last columnar result. The engine remains usable.
+    void dispose() {
+        recognizer.dispose();
+        columns = {};
     }
-    
-    // Process each phone
-    TimeRange lastTimeRange;
-    for (auto it = phones.begin(); it != phones.end(); ++it) {
-        const Phone& phone = it->getValue();
-        const TimeRange& timeRange = it->getTimeRange();
-        const centiseconds duration = timeRange.getDuration();
-        const centiseconds previousDuration = it != phones.begin() 
-            ? std::prev(it)->getTimeRange().getDuration() 
-            : 0_cs;
-            
-        // Add X shape for gaps between phones (silence)
-        if (!lastTimeRange.empty() && timeRange.getStart() > lastTimeRange.getEnd()) {
-            const double gapStart = lastTimeRange.getEnd().count() / 100.0;
-            const double gapEnd = timeRange.getStart().count() / 100.0;
-            if (gapEnd - gapStart >= 0.1) { // Only add X for gaps >= 100ms
-                mouthCues.push_back({
-                    gapStart,
-                    gapEnd,
-                    shapeToString(Shape::X)
-                });
-            }
-        }
-        
-        // Get the set of possible shapes for this phone
-        ShapeSet shapeSet = getPhoneShapeSet(phone, duration, previousDuration);
-        
-        // Choose the best shape based on the current shape
-        Shape nextShape = getClosestShape(currentShape, shapeSet);
-        
-        // Special handling for plosives
-        if (phone == Phone::P || phone == Phone::B || phone == Phone::T || phone == Phone::D) {
-            const centiseconds occlusionDuration = std::min(std::max(previousDuration / 2, 4_cs), 12_cs);
-            const centiseconds occlusionStart = timeRange.getStart() - occlusionDuration;
-            
-            // Add pre-occlusion shape
-            if (phone == Phone::P || phone == Phone::B) {
-                mouthCues.push_back({
-                    occlusionStart.count() / 100.0,
-                    timeRange.getStart().count() / 100.0,
-                    shapeToString(Shape::A)
-                });
-            } else {
-                mouthCues.push_back({
-                    occlusionStart.count() / 100.0,
-                    timeRange.getStart().count() / 100.0,
-                    shapeToString(Shape::B)
-                });
-            }
-        }
-        
-        // Add the main shape
-        mouthCues.push_back({
-            timeRange.getStart().count() / 100.0,
-            timeRange.getEnd().count() / 100.0,
-            shapeToString(nextShape)
-        });
-        
-        currentShape = nextShape;
-        lastTimeRange = timeRange;
+
+    // If set, results contain parallel typed arrays instead of one object per mouth cue.
+    // The typed arrays are views into WASM memory. They remain valid until the next call
+    // into the engine or until WASM memory grows, whichever comes first.
+    bool getColumnarResults() const {
+        return columnarResults;
     }
-    
-    // Add final X shape if there's silence at the end
-    if (!phones.empty()) {
-        const TimeRange& lastPhone = phones.rbegin()->getTimeRange();
-        if (lastPhone.getEnd().count() / 100.0 < audioDurationSeconds) {
-            mouthCues.push_back({
-                lastPhone.getEnd().count() / 100.0,
-                audioDurationSeconds,
-                shapeToString(Shape::X)
-            });
-        }
+
+    void setColumnarResults(bool value) {
+        columnarResults = value;
     }
-    
-    // Consolidate similar consecutive shapes
-    std::vector<MouthCue> consolidatedCues;
-    for (size_t i = 0; i < mouthCues.size(); ++i) {
-        if (consolidatedCues.empty() || 
-            consolidatedCues.back().value != mouthCues[i].value ||
-            std::abs(consolidatedCues.back().end - mouthCues[i].start) > 0.001) {
-            consolidatedCues.push_back(mouthCues[i]);
-        } else {
-            consolidatedCues.back().end = mouthCues[i].end;
-        }
+
+    // If set, the dialog text is assumed to be exactly what is said, e.g. for speech synthesis.
+    // It is then aligned with the audio directly instead of guiding speech recognition.
+    // Streaming sessions always use recognition.
+    bool getExactDialog() const {
+        return exactDialog;
     }
-    
-    return consolidatedCues;
-}
 
-// Convert raw PCM data to float audio buffer
-std::vector<float> pcmToAudioBuffer(const emscripten::val& buffer) {
-    debugLog("Converting PCM data to audio buffer");
-    
-    // Get the underlying ArrayBuffer
-    emscripten::val arrayBuffer = buffer["buffer"];
-    size_t byteLength = buffer["length"].as<size_t>();
-    size_t sampleCount = byteLength / sizeof(int16_t);
-    
-    debugLog("Input byte length: " + std::to_string(byteLength));
-    debugLog("Input sample count: " + std::to_string(sampleCount));
-    
-    // Create a typed array view of the buffer
-    emscripten::val int16Array = emscripten::val::global("Int16Array").new_(arrayBuffer);
-    
-    std::vector<float> audioBuffer(sampleCount);
-    float minSample = 0.0f, maxSample = 0.0f;
-    
-    // Convert 16-bit PCM to normalized float (-1.0 to 1.0)
-    for (size_t i = 0; i < sampleCount; i++) {
-        int16_t sample = int16Array[i].as<int16_t>();
-        float normalizedSample = static_cast<float>(sample) / 32768.0f;
-        audioBuffer[i] = normalizedSample;
-        
-        minSample = std::min(minSample, normalizedSample);
-        maxSample = std::max(maxSample, normalizedSample);
+    void setExactDialog(bool value) {
+        exactDialog = value;
+        recognizer.setExactDialog(value);
     }
-    
-    debugLog("Audio buffer conversion complete");
-    debugLog("Sample range: " + formatNumber(minSample) + " to " + formatNumber(maxSample));
-    
-    return audioBuffer;
-}
 
-// Create AudioClip from processed buffer
-std::unique_ptr<AudioClip> createAudioClip(const std::vector<float>& buffer, const AudioFormatInfo& formatInfo) {
-    return std::make_unique<BufferAudioClip>(buffer.data(), buffer.size(), formatInfo.frameRate);
+    // If set, recognition only considers the words of the dialog text, using a grammar.
+    // Unlike exactDialog, this applies to streaming sessions as well.
+    bool getDialogGrammar() const {
+        return dialogGrammar;
+    }
+
+    void setDialogGrammar(bool value) {
+        dialogGrammar = value;
+        recognizer.setDialogGrammar(value);
+    }
+
+    const PocketSphinxRecognizer& getRecognizer() const {
+        return recognizer;
+    }
+
+private:
+    emscripten::val processAudioClip(const AudioClip& audioClip, const std::string& dialogText);
+    emscripten::val toObjectResult(const std::vector<MouthCue>& mouthCues);
+    emscripten::val toColumnarResult(const std::vector<MouthCue>& mouthCues);
+
+    PocketSphinxRecognizer recognizer;
+    bool columnarResults = false;
+    bool exactDialog = false;
+    bool dialogGrammar = false;
+    MouthCueColumns columns;
+};
+
+emscripten::val LipSyncEngine::getLipSync(emscripten::val pcmData, const std::string& dialogText) {
+    const AudioFormatInfo formatInfo;
+    if (pcmData.instanceof(emscripten::val::global("Float32Array"))) {
+        const std::vector<float> samples = copyTypedArray<float>(pcmData);
+        return processAudioClip(MemoryAudioClip<float>(samples.data(), samples.size(), formatInfo.frameRate), dialogText);
+    }
+
+    const std::vector<int16_t> samples = copyTypedArray<int16_t>(pcmData);
+    return processAudioClip(MemoryAudioClip<int16_t>(samples.data(), samples.size(), formatInfo.frameRate), dialogText);
 }
 
-// Main function to process audio and generate lip sync data
-// Note: pcmData is expected to be a Buffer containing 16-bit PCM mono at 16kHz
-emscripten::val getLipSync(emscripten::val pcmData, const std::string& dialogText = "") {
+emscripten::val LipSyncEngine::processAudioClip(const AudioClip& audioClip, const std::string& dialogText) {
     debugLog("Starting lip sync processing");
     LipSyncResult result;
     
     try {
-        // Initialize audio format info (we expect 16kHz mono PCM)
-        AudioFormatInfo formatInfo;
-        debugLog("Audio format - Channels: " + std::to_string(formatInfo.channelCount) + 
-                ", Rate: " + std::to_string(formatInfo.frameRate) + 
-                ", Bits: " + std::to_string(formatInfo.bitsPerSample));
-        
-        // Convert PCM to float audio buffer
-        std::vector<float> audioBuffer = pcmToAudioBuffer(pcmData);
-        debugLog("Audio buffer size: " + std::to_string(audioBuffer.size()));
+        debugLog("Audio sample count: " + std::to_string(audioClip.size()) +
+                ", Rate: " + std::to_string(audioClip.getSampleRate()));
         
         // Calculate audio duration in seconds
-        double audioDurationSeconds = static_cast<double>(audioBuffer.size()) / formatInfo.frameRate;
+        double audioDurationSeconds = static_cast<double>(audioClip.size()) / audioClip.getSampleRate();
         debugLog("Audio duration: " + formatNumber(audioDurationSeconds) + "s");
         
-        // Create audio clip
-        auto audioClip = createAudioClip(audioBuffer, formatInfo);
-        debugLog("Audio clip created");
-        
-        // Create PocketSphinx recognizer
-        auto recognizer = std::make_unique<PocketSphinxRecognizer>();
-        debugLog("PocketSphinx recognizer created");
-        
         // Create progress sink
         WebProgressSink progressSink;
         
         // Process audio and get recognition result with optimal thread count
         boost::optional<std::string> dialog = dialogText.empty() ? boost::none : boost::optional<std::string>(dialogText);
-        const int maxThreadCount = std::thread::hardware_concurrency();
+        const int maxThreadCount = getRecognitionThreadCount();
         debugLog("Using " + std::to_string(maxThreadCount) + " threads for recognition");
         
-        auto recognitionResult = recognizer->recognizePhones(*audioClip, dialog, maxThreadCount, progressSink);
-        debugLog("Phone recognition complete");
-        
-        // Process phones to get mouth cues
-        result.mouthCues = processPhones(recognitionResult, audioDurationSeconds);
+        result.mouthCues = animateAudioClip(audioClip, dialog, recognizer, maxThreadCount, progressSink);
         debugLog("Generated " + std::to_string(result.mouthCues.size()) + " mouth cues");
         
         // Log the first few mouth cues for debugging
@@ -372,28 +279,124 @@ emscripten::val getLipSync(emscripten::val pcmData, const std::string& dialogTex
         throw;
     }
     
-    // Convert vector to JavaScript array
-    emscripten::val mouthCuesArray = emscripten::val::array();
-    for (const auto& cue : result.mouthCues) {
-        emscripten::val cueObj = emscripten::val::object();
-        cueObj.set("start", cue.start);
-        cueObj.set("end", cue.end);
-        cueObj.set("value", cue.value);
-        mouthCuesArray.call<void>("push", cueObj);
+    return columnarResults
+        ? toColumnarResult(result.mouthCues)
+        : toObjectResult(result.mouthCues);
+}
+
+emscripten::val LipSyncEngine::toObjectResult(const std::vector<MouthCue>& mouthCues) {
+    emscripten::val resultObj = emscripten::val::object();
+    resultObj.set("mouthCues", toMouthCueArray(mouthCues));
+    return resultObj;
+}
+
+emscripten::val LipSyncEngine::toColumnarResult(const std::vector<MouthCue>& mouthCues) {
+    // Keep the columns alive in the engine so the views stay valid after returning
+    columns.start.resize(mouthCues.size());
+    columns.end.resize(mouthCues.size());
+    columns.shape.resize(mouthCues.size());
+    for (size_t i = 0; i < mouthCues.size(); ++i) {
+        columns.start[i] = mouthCues[i].start;
+        columns.end[i] = mouthCues[i].end;
+        columns.shape[i] = mouthCues[i].shape;
     }
-    
+
+    emscripten::val columnsObj = emscripten::val::object();
+    columnsObj.set("start", emscripten::val(emscripten::typed_memory_view(columns.start.size(), columns.start.data())));
+    columnsObj.set("end", emscripten::val(emscripten::typed_memory_view(columns.end.size(), columns.end.data())));
+    columnsObj.set("shape", emscripten::val(emscripten::typed_memory_view(columns.shape.size(), columns.shape.data())));
+
     emscripten::val resultObj = emscripten::val::object();
-    resultObj.set("mouthCues", mouthCuesArray);
+    resultObj.set("mouthCues", columnsObj);
     return resultObj;
 }
 
+// Lip sync session for audio that arrives in chunks, e.g. from streaming speech synthesis.
+// Whenever a chunk completes an utterance, the utterance is recognized and the callback is
+// invoked with its mouth cues. The session holds one of the engine's decoders until it is flushed.
+class LipSyncSession {
+public:
+    // The engine must outlive the session
+    LipSyncSession(LipSyncEngine* engine, const std::string& dialogText, emscripten::val onMouthCues) :
+        onMouthCues(onMouthCues),
+        phoneRecognizer(
+            engine->getRecognizer(),
+            dialogText.empty() ? boost::none : boost::optional<std::string>(dialogText),
+            [this](const Timeline<Phone>& utterancePhones) {
+                emitMouthCues(mouthCueGenerator.addPhones(utterancePhones));
+            }
+        )
+    {}
+
+    // Appends a chunk of audio in the same formats accepted by LipSyncEngine::getLipSync.
+    // The samples are written straight into the recognizer's buffer through a typed array view.
+    void pushAudio(emscripten::val pcmData) {
+        const bool isFloat = pcmData.instanceof(emscripten::val::global("Float32Array"));
+        const emscripten::val samples = isFloat ? pcmData : toInt16Array(pcmData);
+        const size_t sampleCount = samples["length"].as<size_t>();
+        phoneRecognizer.addAudio(sampleCount, [&](float* buffer) {
+            // Setting 16-bit samples converts them to float, but doesn't scale them
+            emscripten::val(emscripten::typed_memory_view(sampleCount, buffer)).call<void>("set", samples);
+            if (!isFloat) {
+                std::transform(buffer, buffer + sampleCount, buffer, [](float sample) { return sample / 32768; });
+            }
+        });
+    }
+
+    // Marks the end of the audio, emitting the mouth cues for any pending utterance and
+    // the final silence. No audio may be pushed afterwards.
+    void flush() {
+        if (flushed) return;
+
+        phoneRecognizer.finish();
+        const double audioDurationSeconds = phoneRecognizer.getTruncatedRange().getEnd().count() / 100.0;
+        emitMouthCues(mouthCueGenerator.finish(audioDurationSeconds));
+        flushed = true;
+    }
+
+private:
+    void emitMouthCues(const std::vector<MouthCue>& mouthCues) {
+        if (mouthCues.empty()) return;
+
+        onMouthCues(toMouthCueArray(consolidateMouthCues(mouthCues)));
+    }
+
+    emscripten::val onMouthCues;
+    MouthCueGenerator mouthCueGenerator;
+    StreamingPhoneRecognizer phoneRecognizer;
+    bool flushed = false;
+};
+
+// Processes audio using a temporary engine
+emscripten::val getLipSync(emscripten::val pcmData, const std::string& dialogText) {
+    LipSyncEngine engine;
+    return engine.getLipSync(pcmData, dialogText);
+}
+
+// Processes audio using a temporary engine. The options object has the same fields as the
+// TypeScript RhubarbOptions: dialogText, exactDialog and dialogGrammar, all of them optional.
+emscripten::val getLipSyncWithOptions(emscripten::val pcmData, emscripten::val options) {
+    const auto getOption = [&](const char* name) {
+        return options.isUndefined() || options.isNull()
+            ? emscripten::val::undefined()
+            : options[name];
+    };
+    const emscripten::val dialogText = getOption("dialogText");
+
+    LipSyncEngine engine;
+    engine.setExactDialog(getOption("exactDialog").isTrue());
+    engine.setDialogGrammar(getOption("dialogGrammar").isTrue());
+    return engine.getLipSync(pcmData, dialogText.isTrue() ? dialogText.as<std::string>() : std::string());
+}
+
 // Bind C++ functions to JavaScript
 EMSCRIPTEN_BINDINGS(rhubarb_wasm) {
     // Register the MouthCue type
     value_object<MouthCue>("MouthCue")
         .field("start", &MouthCue::start)
         .field("end", &MouthCue::end)
-        .field("value", &MouthCue::value);
+        .field("value", &MouthCue::value)
+        .field("shape", &MouthCue::shape);
         
     // Register the vector<MouthCue> type
     register_vector<MouthCue>("VectorMouthCue");
@@ -402,6 +405,26 @@ EMSCRIPTEN_BINDINGS(rhubarb_wasm) {
     value_object<LipSyncResult>("LipSyncResult")
         .field("mouthCues", &LipSyncResult::mouthCues);
         
-    // Register the getLipSync function
+    // Register the engine class
+    class_<LipSyncEngine>("LipSyncEngine")
+        .constructor<>()
+        .constructor<bool>()
+        .function("getLipSync", &LipSyncEngine::getLipSync)
+        .function("getLipSyncFromInt16Pointer", &LipSyncEngine::getLipSyncFromInt16Pointer)
+        .function("getLipSyncFromFloat32Pointer", &LipSyncEngine::getLipSyncFromFloat32Pointer)
+        .function("prewarm", &LipSyncEngine::prewarm)
+        .function("dispose", &LipSyncEngine::dispose)
+        .property("columnarResults", &LipSyncEngine::getColumnarResults, &LipSyncEngine::setColumnarResults)
+        .property("exactDialog", &LipSyncEngine::getExactDialog, &LipSyncEngine::setExactDialog)
+        .property("dialogGrammar", &LipSyncEngine::getDialogGrammar, &LipSyncEngine::setDialogGrammar);
+
+    // Register the streaming session class
+    class_<LipSyncSession>("LipSyncSession")
+        .constructor<LipSyncEngine*, const std::string&, emscripten::val>(allow_raw_pointers())
+        .function("pushAudio", &LipSyncSession::pushAudio)
+        .function("flush", &LipSyncSession::flush);
+
+    // Register the getLipSync functions
     function("getLipSync", &getLipSync);
+    function("getLipSyncWithOptions", &getLipSyncWithOptions);
 } 
\ No newline at end of file
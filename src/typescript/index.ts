@@ -1,17 +1,37 @@
-import { RhubarbOptions, LipSyncResult, RhubarbWasmModule } from "./types.js";
+import {
+  RhubarbOptions,
+  EngineOptions,
+  LipSyncResult,
+  LipSyncColumnarResult,
+  MouthCue,
+  MouthCueColumns,
+  RhubarbWasmModule,
+  LipSyncEngineHandle,
+  LipSyncSessionHandle,
+  MouthCueCallback,
+  PcmData,
+  SampleFormat,
+  SHAPES,
+} from "./types.js";
 import { initWasmModule } from "./wasm-loader.js";
 
 declare global {
   interface Window {
     RhubarbWasm: {
       getLipSync: (
-        pcmData: Buffer<ArrayBuffer>,
+        pcmData: PcmData,
         options?: RhubarbOptions
       ) => Promise<LipSyncResult>;
     };
   }
 }
 
+function assertPcmData(pcmData: PcmData): void {
+  if (!Buffer.isBuffer(pcmData) && !(pcmData instanceof Int16Array) && !(pcmData instanceof Float32Array)) {
+    throw new Error('pcmData must be a Buffer or Int16Array containing 16-bit PCM audio data or a Float32Array, at 16kHz mono');
+  }
+}
+
 /**
  * Main Rhubarb class for lip sync generation
  */
@@ -25,23 +45,254 @@ export class Rhubarb {
     return this.wasmModule;
   }
 
+  /**
+   * Get the initialized WASM module, e.g. to allocate sample memory via _malloc and HEAP16
+   * @returns Promise resolving to the WASM module
+   */
+  static async getWasmModule(): Promise<RhubarbWasmModule> {
+    return this.getModule();
+  }
+
   /**
    * Generate lip sync data from PCM audio data
-   * @param pcmData Buffer containing 16-bit PCM audio data at 16kHz mono
+   * @param pcmData Buffer or Int16Array containing 16-bit PCM audio data, or Float32Array, at 16kHz mono
    * @param options Optional parameters including dialog text
    * @returns Promise resolving to lip sync result with mouth cues
    */
   static async getLipSync(
-    pcmData: Buffer<ArrayBuffer>,
+    pcmData: PcmData,
     options: RhubarbOptions = {}
   ): Promise<LipSyncResult> {
-    if (!Buffer.isBuffer(pcmData)) {
-      throw new Error('pcmData must be a Buffer containing 16-bit PCM audio data at 16kHz mono');
+    assertPcmData(pcmData);
+
+    const module = await this.getModule();
+    return module.getLipSyncWithOptions(pcmData, options);
+  }
+
+  /**
+   * Generate lip sync data from PCM audio data, returning the mouth cues as parallel typed arrays
+   * @param pcmData Buffer or Int16Array containing 16-bit PCM audio data, or Float32Array, at 16kHz mono
+   * @param options Optional parameters including dialog text
+   * @returns Promise resolving to lip sync result with mouth cue columns
+   */
+  static async getLipSyncColumns(
+    pcmData: PcmData,
+    options: RhubarbOptions = {}
+  ): Promise<LipSyncColumnarResult> {
+    const engine = await this.createEngine();
+    try {
+      const { mouthCues } = engine.getLipSyncColumns(pcmData, options);
+      // The columns are views into engine memory, so copy them before disposing the engine
+      return {
+        mouthCues: {
+          start: mouthCues.start.slice(),
+          end: mouthCues.end.slice(),
+          shape: mouthCues.shape.slice(),
+        },
+      };
+    } finally {
+      engine.dispose();
     }
+  }
 
+  /**
+   * Create a lip sync engine that keeps its speech decoders warm between calls
+   * @param options Optional engine parameters, e.g. to select the compact language model
+   * @returns Promise resolving to a new engine
+   */
+  static async createEngine(options: EngineOptions = {}): Promise<LipSyncEngine> {
     const module = await this.getModule();
-    return module.getLipSync(pcmData, options.dialogText || "");
+    return new LipSyncEngine(module, new module.LipSyncEngine(!!options.compactLanguageModel));
+  }
+}
+
+/**
+ * Reusable lip sync engine. Call dispose() when done to free its native resources.
+ */
+export class LipSyncEngine {
+  private module: RhubarbWasmModule;
+  private handle: LipSyncEngineHandle | null;
+
+  constructor(module: RhubarbWasmModule, handle: LipSyncEngineHandle) {
+    this.module = module;
+    this.handle = handle;
+  }
+
+  private getHandle(): LipSyncEngineHandle {
+    if (!this.handle) {
+      throw new Error('LipSyncEngine has been disposed');
+    }
+    return this.handle;
+  }
+
+  private getHandleFor(options: RhubarbOptions): LipSyncEngineHandle {
+    const handle = this.getHandle();
+    handle.exactDialog = !!options.exactDialog;
+    handle.dialogGrammar = !!options.dialogGrammar;
+    return handle;
+  }
+
+  /**
+   * Generate lip sync data from PCM audio data
+   * @param pcmData Buffer or Int16Array containing 16-bit PCM audio data, or Float32Array, at 16kHz mono
+   * @param options Optional parameters including dialog text
+   * @returns Lip sync result with mouth cues
+   */
+  getLipSync(pcmData: PcmData, options: RhubarbOptions = {}): LipSyncResult {
+    assertPcmData(pcmData);
+
+    return this.getHandleFor(options).getLipSync(pcmData, options.dialogText || "") as LipSyncResult;
+  }
+
+  /**
+   * Generate lip sync data from samples already written to WASM memory (see Rhubarb.getWasmModule).
+   * The samples are used in place without copying. The caller remains responsible for freeing them.
+   * @param pointer Address of the first sample, as returned by _malloc
+   * @param sampleCount Number of samples (not bytes) at 16kHz mono
+   * @param sampleFormat "int16" for 16-bit PCM or "float32" for samples in the range -1..1
+   * @param options Optional parameters including dialog text
+   * @returns Lip sync result with mouth cues
+   */
+  getLipSyncFromPointer(
+    pointer: number,
+    sampleCount: number,
+    sampleFormat: SampleFormat = "int16",
+    options: RhubarbOptions = {}
+  ): LipSyncResult {
+    const handle = this.getHandleFor(options);
+    const dialogText = options.dialogText || "";
+    return (sampleFormat === "float32"
+      ? handle.getLipSyncFromFloat32Pointer(pointer, sampleCount, dialogText)
+      : handle.getLipSyncFromInt16Pointer(pointer, sampleCount, dialogText)) as LipSyncResult;
+  }
+
+  /**
+   * Generate lip sync data from PCM audio data, returning the mouth cues as parallel typed arrays.
+   * The arrays are views into WASM memory. They are only valid until the next call into the engine
+   * or the WASM module; copy them (e.g. using slice()) if you need them for longer.
+   * @param pcmData Buffer or Int16Array containing 16-bit PCM audio data, or Float32Array, at 16kHz mono
+   * @param options Optional parameters including dialog text
+   * @returns Lip sync result with mouth cue columns
+   */
+  getLipSyncColumns(pcmData: PcmData, options: RhubarbOptions = {}): LipSyncColumnarResult {
+    assertPcmData(pcmData);
+
+    return this.withColumnarResults(() => this.getLipSync(pcmData, options));
+  }
+
+  /**
+   * Same as getLipSyncFromPointer, but returns the mouth cues as parallel typed arrays.
+   * See getLipSyncColumns for the lifetime of the arrays.
+   */
+  getLipSyncColumnsFromPointer(
+    pointer: number,
+    sampleCount: number,
+    sampleFormat: SampleFormat = "int16",
+    options: RhubarbOptions = {}
+  ): LipSyncColumnarResult {
+    return this.withColumnarResults(() => this.getLipSyncFromPointer(pointer, sampleCount, sampleFormat, options));
+  }
+
+  /**
+   * Load speech decoders ahead of time so that the first calls don't pay for it
+   * @param decoderCount Number of decoders to create
+   */
+  prewarm(decoderCount: number = 1): void {
+    this.getHandle().prewarm(decoderCount);
+  }
+
+  /**
+   * Start a streaming session for audio that arrives in chunks, e.g. from a speech synthesizer.
+   * Mouth cues are reported per utterance while later audio is still arriving.
+   * The session must be disposed before the engine.
+   * @param onMouthCues Called with the mouth cues of each recognized utterance, in order
+   * @param options Optional parameters including dialog text
+   * @returns New streaming session
+   */
+  createSession(onMouthCues: MouthCueCallback, options: RhubarbOptions = {}): LipSyncSession {
+    return new LipSyncSession(
+      new this.module.LipSyncSession(this.getHandleFor(options), options.dialogText || "", onMouthCues)
+    );
+  }
+
+  private withColumnarResults(
+    getResult: (handle: LipSyncEngineHandle) => LipSyncResult | LipSyncColumnarResult
+  ): LipSyncColumnarResult {
+    const handle = this.getHandle();
+    handle.columnarResults = true;
+    try {
+      return getResult(handle) as LipSyncColumnarResult;
+    } finally {
+      handle.columnarResults = false;
+    }
+  }
+
+  /**
+   * Free all decoders and the native engine object
+   */
+  dispose(): void {
+    if (!this.handle) return;
+
+    this.handle.dispose();
+    this.handle.delete();
+    this.handle = null;
+  }
+}
+
+/**
+ * Streaming lip sync session. Push audio chunks as they arrive, then call flush() once at the end.
+ */
+export class LipSyncSession {
+  private handle: LipSyncSessionHandle | null;
+
+  constructor(handle: LipSyncSessionHandle) {
+    this.handle = handle;
+  }
+
+  private getHandle(): LipSyncSessionHandle {
+    if (!this.handle) {
+      throw new Error('LipSyncSession has been disposed');
+    }
+    return this.handle;
+  }
+
+  /**
+   * Append a chunk of audio. Mouth cues for any utterances it completes are reported synchronously.
+   * @param pcmData Buffer or Int16Array containing 16-bit PCM audio data, or Float32Array, at 16kHz mono
+   */
+  pushAudio(pcmData: PcmData): void {
+    assertPcmData(pcmData);
+
+    this.getHandle().pushAudio(pcmData);
+  }
+
+  /**
+   * Mark the end of the audio, reporting the mouth cues for the remaining audio
+   */
+  flush(): void {
+    this.getHandle().flush();
+  }
+
+  /**
+   * Free the native session object and return its decoder to the engine
+   */
+  dispose(): void {
+    if (!this.handle) return;
+
+    this.handle.delete();
+    this.handle = null;
   }
 }
 
-export type { RhubarbOptions, LipSyncResult };
+export { SHAPES };
+export type {
+  RhubarbOptions,
+  EngineOptions,
+  LipSyncResult,
+  LipSyncColumnarResult,
+  MouthCue,
+  MouthCueColumns,
+  MouthCueCallback,
+  PcmData,
+  SampleFormat,
+};
@@ -2,18 +2,98 @@
 
 export interface RhubarbOptions {
   dialogText?: string;
+  // The dialog text is exactly what is said, e.g. for speech synthesis. It is then aligned with the
+  // audio directly instead of only guiding speech recognition, which is several times faster.
+  exactDialog?: boolean;
+  // Recognize only the words of the dialog text, allowing for skipped and repeated words. This uses
+  // a small grammar instead of a large language model, so it is faster and needs less memory.
+  dialogGrammar?: boolean;
 }
 
+export interface EngineOptions {
+  // Use the compact language model, which loads faster and needs less memory at the cost of some
+  // accuracy. It is only available in builds that include it.
+  compactLanguageModel?: boolean;
+}
+
+/**
+ * Audio samples at 16kHz mono: a Buffer or Int16Array of 16-bit PCM, or a Float32Array in the range -1..1
+ */
+export type PcmData = Buffer<ArrayBuffer> | Int16Array | Float32Array;
+
+/**
+ * Format of samples written directly to WASM memory
+ */
+export type SampleFormat = "int16" | "float32";
+
+/**
+ * Shape values, indexed by shape ordinal
+ */
+export const SHAPES = ["A", "B", "C", "D", "E", "F", "G", "H", "X"] as const;
+
 export interface MouthCue {
   start: number;  // Start time in seconds
   end: number;    // End time in seconds
   value: string;  // Shape value (A, B, C, D, E, F, G, H, X)
+  shape: number;  // Shape ordinal (index into SHAPES)
 }
 
 export interface LipSyncResult {
   mouthCues: MouthCue[];
 }
 
+/**
+ * Mouth cues as parallel arrays. Element i of each array describes cue i.
+ */
+export interface MouthCueColumns {
+  start: Float64Array;  // Start times in seconds
+  end: Float64Array;    // End times in seconds
+  shape: Uint8Array;    // Shape ordinals (indexes into SHAPES)
+}
+
+export interface LipSyncColumnarResult {
+  mouthCues: MouthCueColumns;
+}
+
+export interface LipSyncEngineHandle {
+  // If set, the getLipSync* methods return LipSyncColumnarResult instead of LipSyncResult
+  columnarResults: boolean;
+  // If set, the getLipSync* methods align the dialog text directly (see RhubarbOptions)
+  exactDialog: boolean;
+  // If set, recognition only considers the words of the dialog text (see RhubarbOptions)
+  dialogGrammar: boolean;
+  getLipSync: (pcmData: PcmData, dialogText: string) => LipSyncResult | LipSyncColumnarResult;
+  getLipSyncFromInt16Pointer: (
+    pointer: number, sampleCount: number, dialogText: string
+  ) => LipSyncResult | LipSyncColumnarResult;
+  getLipSyncFromFloat32Pointer: (
+    pointer: number, sampleCount: number, dialogText: string
+  ) => LipSyncResult | LipSyncColumnarResult;
+  prewarm: (decoderCount: number) => void;
+  dispose: () => void;
+  delete: () => void;  // Frees the native object
+}
+
+export interface LipSyncSessionHandle {
+  pushAudio: (pcmData: PcmData) => void;
+  flush: () => void;
+  delete: () => void;  // Frees the native object
+}
+
+/**
+ * Called with the mouth cues of each utterance as soon as it has been recognized
+ */
+export type MouthCueCallback = (mouthCues: MouthCue[]) => void;
+
 export interface RhubarbWasmModule {
-  getLipSync: (pcmData: Buffer<ArrayBuffer>, dialogText?: string) => LipSyncResult;
+  getLipSync: (pcmData: PcmData, dialogText: string) => LipSyncResult;
+  getLipSyncWithOptions: (pcmData: PcmData, options: RhubarbOptions) => LipSyncResult;
+  LipSyncEngine: new (compactLanguageModel?: boolean) => LipSyncEngineHandle;
+  LipSyncSession: new (
+    engine: LipSyncEngineHandle, dialogText: string, onMouthCues: MouthCueCallback
+  ) => LipSyncSessionHandle;
+  _malloc: (byteCount: number) => number;
+  _free: (pointer: number) => void;
+  HEAP16: Int16Array;
+  HEAPF32: Float32Array;
 }
@@ -2,22 +2,51 @@
 
 import { fileURLToPath } from "url";
 import { dirname, join } from "path";
-import { RhubarbWasmModule, LipSyncResult } from "./types.js";
+import { cpus } from "os";
+import { RhubarbWasmModule, LipSyncResult, PcmData } from "./types.js";
 
 let wasmModule: RhubarbWasmModule | null = null;
 
+/**
+ * Whether the threaded WASM build can be used. It needs SharedArrayBuffer, which browsers only
+ * provide to cross-origin isolated pages. Node always provides it.
+ */
+function canUseThreads(): boolean {
+  if (typeof SharedArrayBuffer === "undefined") {
+    return false;
+  }
+  const isolated = (globalThis as { crossOriginIsolated?: boolean }).crossOriginIsolated;
+  return isolated === undefined || isolated;
+}
+
+async function importWasmFactory(): Promise<{ factory: any; threaded: boolean }> {
+  if (canUseThreads()) {
+    try {
+      const module = await import("./wasm/rhubarb-threaded.js");
+      return { factory: module.default, threaded: true };
+    } catch {
+      // The threaded variant is optional; fall back to the single-threaded one
+    }
+  }
+
+  const module = await import("./wasm/rhubarb.js");
+  return { factory: module.default, threaded: false };
+}
+
 export async function initWasmModule(): Promise<RhubarbWasmModule> {
   const __filename = fileURLToPath(import.meta.url);
   const __dirname = dirname(__filename);
 
-  const module = await import("./wasm/rhubarb.js");
-  const instance = await module.default({
+  const { factory, threaded } = await importWasmFactory();
+  const instance = await factory({
     locateFile: (path: string) => {
-      if (path.endsWith(".wasm") || path.endsWith(".data")) {
+      if (path.endsWith(".wasm") || path.endsWith(".data") || path.endsWith(".worker.js")) {
         return join(__dirname, "wasm", path);
       }
       return path;
     },
+    // Start one worker per core, matching the number of recognition threads
+    ...(threaded ? { pthreadPoolSize: cpus().length || 4 } : {}),
   });
 
   wasmModule = instance;
@@ -26,16 +55,16 @@ export async function initWasmModule(): Promise<RhubarbWasmModule> {
 
 /**
  * Generate lip sync data from PCM audio data
- * @param pcmData Buffer containing 16-bit PCM audio data at 16kHz mono
+ * @param pcmData Buffer or Int16Array containing 16-bit PCM audio data, or Float32Array, at 16kHz mono
  * @param dialogText Optional dialog text for improved recognition
  * @returns Promise resolving to lip sync result with mouth cues
  */
 export async function getLipSyncData(
-  pcmData: Buffer<ArrayBuffer>,
+  pcmData: PcmData,
   dialogText?: string
 ): Promise<LipSyncResult> {
-  if (!Buffer.isBuffer(pcmData)) {
-    throw new Error('pcmData must be a Buffer containing 16-bit PCM audio data at 16kHz mono');
+  if (!Buffer.isBuffer(pcmData) && !(pcmData instanceof Int16Array) && !(pcmData instanceof Float32Array)) {
+    throw new Error('pcmData must be a Buffer or Int16Array containing 16-bit PCM audio data or a Float32Array, at 16kHz mono');
   }
 
   const module = await initWasmModule();